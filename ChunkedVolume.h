@@ -0,0 +1,347 @@
+#ifndef IMAGEPROCESSING_CHUNKED_VOLUME_H__
+#define IMAGEPROCESSING_CHUNKED_VOLUME_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vigra/multi_array.hxx>
+#include "ExplicitVolume.h"
+#include "MappedFile.h"
+#include "exceptions.h"
+
+/**
+ * A read-only discrete volume backed by a directory of chunk files. Chunks are 
+ * memory-mapped on demand, such that only the chunks that are accessed are 
+ * read from disk. At most a fixed number of chunks is kept mapped at the same 
+ * time, the least recently used ones are released first.
+ *
+ * Chunk (i,j,k) is expected in a file "<directory>/<i>.<j>.<k>" that contains 
+ * the raw values of type ValueType in x-major order (x changes fastest). 
+ * Chunks at the upper borders of the volume are padded to the full chunk size.  
+ * Missing chunk files are treated as being filled with zeros.
+ *
+ * Each thread remembers the chunk it accessed last, such that voxel access 
+ * consults the shared chunk cache (and locks it) only when it enters another 
+ * chunk. The remembered chunk stays mapped until the thread accesses another 
+ * volume or chunk, even if the cache released it.
+ */
+template <typename ValueType>
+class ChunkedVolume : public DiscreteVolume {
+
+	typedef util::point<unsigned int, 3>              ChunkIndex;
+	typedef vigra::MultiArrayView<3, ValueType>       ChunkView;
+	typedef std::shared_ptr<MappedFile>               Chunk;
+	typedef std::list<ChunkIndex>                     LruList;
+	typedef std::map<ChunkIndex, std::pair<Chunk, typename LruList::iterator>, bool(*)(const ChunkIndex&, const ChunkIndex&)> ChunkCache;
+
+	/**
+	 * The chunk accessed last by a thread or an accessor.
+	 */
+	struct LastChunk {
+
+		// the id of the volume the chunk belongs to, 0 for none
+		std::uint64_t volume = 0;
+		ChunkIndex    index;
+		Chunk         chunk;
+	};
+
+public:
+
+	typedef ValueType value_type;
+
+	/**
+	 * Open a chunked volume.
+	 *
+	 * @param directory
+	 *              The directory containing the chunk files.
+	 * @param width, height, depth
+	 *              The size of the volume in voxels.
+	 * @param chunkWidth, chunkHeight, chunkDepth
+	 *              The size of a chunk in voxels.
+	 * @param maxMappedChunks
+	 *              The maximal number of chunks to keep mapped at the same 
+	 *              time.
+	 */
+	ChunkedVolume(
+			const std::string& directory,
+			unsigned int width,
+			unsigned int height,
+			unsigned int depth,
+			unsigned int chunkWidth,
+			unsigned int chunkHeight,
+			unsigned int chunkDepth,
+			std::size_t  maxMappedChunks = 1024) :
+		_directory(directory),
+		_shape(width, height, depth),
+		_chunkShape(chunkWidth, chunkHeight, chunkDepth),
+		_maxMappedChunks(std::max(maxMappedChunks, (std::size_t)1)),
+		_chunks(&lessChunkIndex),
+		_id(nextId()) {}
+
+	/**
+	 * Voxel access for scans, with a chunk cache of its own. Cheaper than the 
+	 * voxel access of the volume, which has to find the cache of the calling 
+	 * thread first. Not thread-safe, use one accessor per thread.
+	 */
+	class Accessor {
+
+	public:
+
+		explicit Accessor(const ChunkedVolume& volume) :
+			_volume(volume) {}
+
+		ValueType operator()(unsigned int x, unsigned int y, unsigned int z) { return _volume.value(_lastChunk, x, y, z); }
+
+	private:
+
+		const ChunkedVolume& _volume;
+		LastChunk            _lastChunk;
+	};
+
+	/**
+	 * Get an accessor for scans over this volume from a single thread.
+	 */
+	Accessor accessor() const { return Accessor(*this); }
+
+	/**
+	 * Pixel access. Values are returned by copy, since the chunk containing 
+	 * the voxel might get unmapped after the call.
+	 */
+	ValueType operator[](vigra::Shape3 pos) const { return (*this)(pos[0], pos[1], pos[2]); }
+	ValueType operator[](util::point<unsigned int, 3> pos) const { return (*this)(pos.x(), pos.y(), pos.z()); }
+	ValueType operator()(unsigned int x, unsigned int y, unsigned int z) const {
+
+		static thread_local LastChunk lastChunk;
+
+		return value(lastChunk, x, y, z);
+	}
+
+	/**
+	 * 2D z-slice access.
+	 */
+	Image slice(int z) const {
+
+		ExplicitVolume<ValueType> section(width(), height(), 1);
+		copyRegion(
+				util::point<unsigned int, 3>(0, 0, z),
+				util::point<unsigned int, 3>(width(), height(), z + 1),
+				section.data());
+
+		Image image;
+		image = section.data().template bind<2>(0);
+		image.setResolution(
+				getResolutionX(),
+				getResolutionY(),
+				getResolutionZ());
+		image.setOffset(
+						getBoundingBox().min().x(),
+						getBoundingBox().min().y(),
+						getBoundingBox().min().z() + z*getResolutionZ());
+
+		return image;
+	}
+
+	unsigned int width()  const { return _shape[0]; }
+	unsigned int height() const { return _shape[1]; }
+	unsigned int depth()  const { return _shape[2]; }
+
+	unsigned int chunkWidth()  const { return _chunkShape[0]; }
+	unsigned int chunkHeight() const { return _chunkShape[1]; }
+	unsigned int chunkDepth()  const { return _chunkShape[2]; }
+
+	/**
+	 * Copy a subvolume of this volume into memory. Only the chunks 
+	 * intersecting the requested subvolume will be read.
+	 *
+	 * @param boundingBox
+	 *              The bounding box of the requested subvolume. The target gets 
+	 *              resized to be at least that large, but might be larger to 
+	 *              fit all the voxels that are intersecting the requested 
+	 *              subvolume.
+	 * @param target
+	 *              An explicit volume to fill.
+	 */
+	void cut(const util::box<float, 3>& boundingBox, ExplicitVolume<ValueType>& target) const {
+
+		util::point<unsigned int, 3> begin, end;
+
+		if (!getDiscreteRegion(boundingBox, begin, end)) {
+
+			target = ExplicitVolume<ValueType>();
+			return;
+		}
+
+		target = ExplicitVolume<ValueType>(
+				end.x() - begin.x(),
+				end.y() - begin.y(),
+				end.z() - begin.z());
+		target.setResolution(getResolution());
+		target.setOffset(getOffset() + begin*getResolution());
+
+		copyRegion(begin, end, target.data());
+	}
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override {
+
+		return util::box<unsigned int,3>(0, 0, 0, _shape[0], _shape[1], _shape[2]);
+	}
+
+private:
+
+	static std::uint64_t nextId() {
+
+		static std::atomic<std::uint64_t> id(0);
+		return ++id;
+	}
+
+	/**
+	 * Get a voxel, using the given last chunk if it contains the voxel, and 
+	 * replacing it otherwise.
+	 */
+	ValueType value(LastChunk& lastChunk, unsigned int x, unsigned int y, unsigned int z) const {
+
+		ChunkIndex index(x/_chunkShape[0], y/_chunkShape[1], z/_chunkShape[2]);
+
+		if (lastChunk.volume != _id || !(lastChunk.index == index)) {
+
+			lastChunk.chunk  = getChunk(index);
+			lastChunk.volume = _id;
+			lastChunk.index  = index;
+		}
+
+		if (!lastChunk.chunk)
+			return ValueType(0);
+
+		return reinterpret_cast<const ValueType*>(lastChunk.chunk->data())[
+				(x%_chunkShape[0]) +
+				static_cast<std::size_t>(_chunkShape[0])*(
+						(y%_chunkShape[1]) +
+						static_cast<std::size_t>(_chunkShape[1])*(z%_chunkShape[2]))];
+	}
+
+	static bool lessChunkIndex(const ChunkIndex& a, const ChunkIndex& b) {
+
+		if (a.z() != b.z()) return a.z() < b.z();
+		if (a.y() != b.y()) return a.y() < b.y();
+		return a.x() < b.x();
+	}
+
+	/**
+	 * Copy the voxels in [begin, end) into target, which is expected to be of 
+	 * size end - begin and initialized with zeros.
+	 */
+	template <typename Target>
+	void copyRegion(
+			const util::point<unsigned int, 3>& begin,
+			const util::point<unsigned int, 3>& end,
+			Target&& target) const {
+
+		typedef vigra::Shape3 Shape;
+
+		for (unsigned int k = begin.z()/_chunkShape[2]; k*_chunkShape[2] < end.z(); k++)
+		for (unsigned int j = begin.y()/_chunkShape[1]; j*_chunkShape[1] < end.y(); j++)
+		for (unsigned int i = begin.x()/_chunkShape[0]; i*_chunkShape[0] < end.x(); i++) {
+
+			Chunk chunk = getChunk(ChunkIndex(i, j, k));
+
+			// missing chunks are zero
+			if (!chunk)
+				continue;
+
+			Shape chunkBegin(i*_chunkShape[0], j*_chunkShape[1], k*_chunkShape[2]);
+
+			// the part of the region covered by this chunk, in volume 
+			// coordinates
+			Shape from(
+					std::max<vigra::MultiArrayIndex>(begin.x(), chunkBegin[0]),
+					std::max<vigra::MultiArrayIndex>(begin.y(), chunkBegin[1]),
+					std::max<vigra::MultiArrayIndex>(begin.z(), chunkBegin[2]));
+			Shape to(
+					std::min<vigra::MultiArrayIndex>(end.x(), chunkBegin[0] + _chunkShape[0]),
+					std::min<vigra::MultiArrayIndex>(end.y(), chunkBegin[1] + _chunkShape[1]),
+					std::min<vigra::MultiArrayIndex>(end.z(), chunkBegin[2] + _chunkShape[2]));
+
+			Shape regionBegin(begin.x(), begin.y(), begin.z());
+
+			target.subarray(from - regionBegin, to - regionBegin) =
+					chunkView(*chunk).subarray(from - chunkBegin, to - chunkBegin);
+		}
+	}
+
+	/**
+	 * Get the mapping of a chunk, or an empty pointer, if the chunk file does 
+	 * not exist.
+	 */
+	Chunk getChunk(const ChunkIndex& index) const {
+
+		std::lock_guard<std::mutex> lock(_chunksMutex);
+
+		auto i = _chunks.find(index);
+
+		if (i != _chunks.end()) {
+
+			// mark as most recently used
+			_lru.splice(_lru.begin(), _lru, i->second.second);
+			return i->second.first;
+		}
+
+		std::stringstream filename;
+		filename << _directory << "/" << index.x() << "." << index.y() << "." << index.z();
+
+		Chunk chunk;
+		if (MappedFile::exists(filename.str())) {
+
+			chunk = std::make_shared<MappedFile>(filename.str());
+
+			std::size_t required = sizeof(ValueType)*_chunkShape[0]*_chunkShape[1]*_chunkShape[2];
+			if (chunk->size() < required)
+				UTIL_THROW_EXCEPTION(
+						FileAccessError,
+						filename.str() << " contains " << chunk->size() << " bytes, but "
+						<< required << " bytes are needed for a chunk");
+		}
+
+		if (_chunks.size() == _maxMappedChunks) {
+
+			// release least recently used chunk, it will stay mapped until 
+			// all current users are done with it
+			_chunks.erase(_lru.back());
+			_lru.pop_back();
+		}
+
+		_lru.push_front(index);
+		_chunks.insert(std::make_pair(index, std::make_pair(chunk, _lru.begin())));
+
+		return chunk;
+	}
+
+	ChunkView chunkView(const MappedFile& chunk) const {
+
+		// chunk files are mapped read-only, we only read from the view
+		return ChunkView(_chunkShape, reinterpret_cast<ValueType*>(const_cast<char*>(chunk.data())));
+	}
+
+	std::string   _directory;
+	vigra::Shape3 _shape;
+	vigra::Shape3 _chunkShape;
+	std::size_t   _maxMappedChunks;
+
+	// currently mapped chunks, and their order of use
+	mutable ChunkCache _chunks;
+	mutable LruList    _lru;
+	mutable std::mutex _chunksMutex;
+
+	// identifies this volume in the last chunks of threads
+	std::uint64_t _id;
+};
+
+#endif // IMAGEPROCESSING_CHUNKED_VOLUME_H__
+
@@ -0,0 +1,15 @@
+#include "CompactGraphVolume.h"
+
+CompactGraphVolume::CompactGraphVolume() {}
+
+util::box<unsigned int,3>
+CompactGraphVolume::computeDiscreteBoundingBox() const {
+
+	util::box<unsigned int,3> bb;
+
+	// bounding box of discrete points
+	for (const Position& position : _positions.values())
+		bb.fit(util::box<unsigned int,3>(position, position + Position(1, 1, 1)));
+
+	return bb;
+}
@@ -0,0 +1,161 @@
+#ifndef IMAGEPROCESSING_COMPACT_GRAPH_VOLUME_H__
+#define IMAGEPROCESSING_COMPACT_GRAPH_VOLUME_H__
+
+#include <vector>
+#include "CsrGraph.h"
+#include "ExplicitVolume.h"
+#include "connectivity.h"
+
+/**
+ * A volume represented by nodes and edges on a 3D grid, like GraphVolume, but 
+ * stored in a static CsrGraph. Uses a fraction of the memory of a GraphVolume, 
+ * at the price of not being modifiable after creation. The positions of the 
+ * nodes are stored in a contiguous array.
+ *
+ * Provides the same interface as GraphVolume for reading, such that it can be 
+ * used in its place for Skeletonize.
+ */
+class CompactGraphVolume : public DiscreteVolume {
+
+public:
+
+	typedef CsrGraph                 Graph;
+	typedef Graph::Node              Node;
+	typedef Graph::Edge              Edge;
+	typedef Graph::NodeIt            NodeIt;
+	typedef Graph::EdgeIt            EdgeIt;
+	typedef Graph::IncEdgeIt         IncEdgeIt;
+
+	typedef util::point<unsigned int,3> Position;
+	typedef Graph::NodeMap<Position>    Positions;
+
+	/**
+	 * Create an empty graph volume.
+	 */
+	CompactGraphVolume();
+
+	/**
+	 * Create a graph volume from an explicit volume. Nodes are numbered in 
+	 * scan order, neighboring voxels are connected according to the given 
+	 * connectivity.
+	 */
+	template <typename T>
+	explicit CompactGraphVolume(const ExplicitVolume<T>& volume, Connectivity connectivity = Connectivity26) { createFromVolume(volume, connectivity); }
+
+	/**
+	 * Create a graph volume from a view on an explicit volume.
+	 */
+	template <typename T>
+	explicit CompactGraphVolume(const ExplicitVolumeView<T>& volume, Connectivity connectivity = Connectivity26) { createFromVolume(volume, connectivity); }
+
+	const Graph& graph() const { return _graph; }
+
+	Positions& positions() { return _positions; }
+	const Positions& positions() const { return _positions; }
+
+	/**
+	 * The connectivity this graph volume was created with.
+	 */
+	Connectivity getConnectivity() const { return _connectivity; }
+
+	/**
+	 * Size of neighborhood of a node.
+	 */
+	int numNeighbors() const { return _connectivity; }
+
+	/**
+	 * Size of neighborhood of a node for the default connectivity. Deprecated, 
+	 * use numNeighbors(), which takes the connectivity into account.
+	 */
+	static const int NumNeighbors = 26;
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override;
+
+private:
+
+	template <typename VolumeType>
+	void createFromVolume(const VolumeType& volume, Connectivity connectivity);
+
+	Graph     _graph;
+	Positions _positions;
+
+	Connectivity _connectivity = Connectivity26;
+};
+
+template <typename VolumeType>
+void
+CompactGraphVolume::createFromVolume(const VolumeType& volume, Connectivity connectivity) {
+
+	const int width  = volume.width();
+	const int height = volume.height();
+	const int depth  = volume.depth();
+
+	const std::vector<util::point<int,3> > neighbors = getPrecedingNeighborOffsets(connectivity);
+
+	std::vector<Position> positions;
+	std::vector<int>      us;
+	std::vector<int>      vs;
+
+	// node ids in the current and the previous slice, -1 for background
+	std::vector<int> ids[2] = {
+			std::vector<int>(static_cast<std::size_t>(width)*height, -1),
+			std::vector<int>(static_cast<std::size_t>(width)*height, -1) };
+
+	for (int z = 0; z < depth; z++) {
+
+		std::vector<int>& current  = ids[z%2];
+		std::vector<int>& previous = ids[(z + 1)%2];
+
+		for (int y = 0; y < height; y++)
+		for (int x = 0; x < width;  x++) {
+
+			std::size_t i = x + static_cast<std::size_t>(width)*y;
+
+			if (volume(x, y, z) == 0) {
+
+				current[i] = -1;
+				continue;
+			}
+
+			int id = positions.size();
+			positions.push_back(Position(x, y, z));
+			current[i] = id;
+
+			// connect to all preceding neighbors
+			for (const util::point<int,3>& offset : neighbors) {
+
+				int nx = x + offset.x();
+				int ny = y + offset.y();
+
+				if (nx < 0 || nx >= width || ny < 0 || ny >= height || z + offset.z() < 0)
+					continue;
+
+				int neighbor = (offset.z() < 0 ? previous : current)[nx + static_cast<std::size_t>(width)*ny];
+				if (neighbor < 0)
+					continue;
+
+				us.push_back(neighbor);
+				vs.push_back(id);
+			}
+		}
+	}
+
+	us.shrink_to_fit();
+	vs.shrink_to_fit();
+	positions.shrink_to_fit();
+
+	int numNodes = positions.size();
+	_graph     = Graph(numNodes, std::move(us), std::move(vs));
+	_positions = Positions(_graph, std::move(positions));
+
+	_connectivity = connectivity;
+
+	// our (0,0,0) would be at the same location as volume's (0,0,0)
+	setOffset(volume.getOffset());
+	setResolution(volume.getResolution());
+}
+
+#endif // IMAGEPROCESSING_COMPACT_GRAPH_VOLUME_H__
+
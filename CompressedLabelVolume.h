@@ -0,0 +1,317 @@
+#ifndef IMAGEPROCESSING_COMPRESSED_LABEL_VOLUME_H__
+#define IMAGEPROCESSING_COMPRESSED_LABEL_VOLUME_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "ExplicitVolume.h"
+#include "parallel.h"
+
+/**
+ * A compressed in-memory representation of a label volume. The volume is split 
+ * into blocks of 8x8x8 voxels. Each block stores a palette of the distinct 
+ * labels it contains, and for each voxel a bit-packed index into this palette.  
+ * Blocks with a single label don't store indices at all.
+ *
+ * Single voxels can be read in constant time. Subvolumes are decompressed 
+ * blockwise.
+ */
+template <typename ValueType>
+class CompressedLabelVolume : public DiscreteVolume {
+
+	static const unsigned int BlockSize   = 8;
+	static const unsigned int BlockVoxels = BlockSize*BlockSize*BlockSize;
+
+	typedef std::uint64_t Word;
+
+	struct Block {
+
+		// position of the first palette entry in _palettes
+		std::size_t paletteBegin;
+
+		// position of the first index word in _indices
+		std::size_t indicesBegin;
+
+		// number of bits per index, a power of two (or 0 for a single label)
+		unsigned int bits;
+	};
+
+public:
+
+	typedef ValueType value_type;
+
+	/**
+	 * Create an empty compressed volume.
+	 */
+	CompressedLabelVolume() :
+		_width(0),
+		_height(0),
+		_depth(0),
+		_blocksX(0),
+		_blocksY(0),
+		_blocksZ(0) {}
+
+	/**
+	 * Compress the given volume. Blocks are compressed in parallel.
+	 */
+	explicit CompressedLabelVolume(const ExplicitVolume<ValueType>& volume) :
+		DiscreteVolume(volume),
+		_width(volume.width()),
+		_height(volume.height()),
+		_depth(volume.depth()),
+		_blocksX((_width  + BlockSize - 1)/BlockSize),
+		_blocksY((_height + BlockSize - 1)/BlockSize),
+		_blocksZ((_depth  + BlockSize - 1)/BlockSize) {
+
+		std::size_t numBlocks = _blocksX*_blocksY*_blocksZ;
+
+		std::vector<std::vector<ValueType> > palettes(numBlocks);
+		std::vector<std::vector<Word> >      indices(numBlocks);
+		_blocks.resize(numBlocks);
+
+		// compress each block separately
+		parallelFor(0, numBlocks, [&](std::size_t begin, std::size_t end) {
+
+			ValueType values[BlockVoxels];
+
+			for (std::size_t b = begin; b < end; b++) {
+
+				unsigned int numValues = readBlock(volume, b, values);
+
+				std::vector<ValueType>& palette = palettes[b];
+				palette.assign(values, values + numValues);
+				std::sort(palette.begin(), palette.end());
+				palette.erase(std::unique(palette.begin(), palette.end()), palette.end());
+
+				unsigned int bits = 0;
+				if (palette.size() > 1) {
+
+					bits = 1;
+					while ((std::size_t(1) << bits) < palette.size())
+						bits *= 2;
+				}
+				_blocks[b].bits = bits;
+
+				if (bits == 0)
+					continue;
+
+				indices[b].assign(BlockVoxels*bits/(8*sizeof(Word)), 0);
+				for (unsigned int i = 0; i < numValues; i++) {
+
+					Word index = std::lower_bound(palette.begin(), palette.end(), values[i]) - palette.begin();
+					indices[b][i*bits/(8*sizeof(Word))] |= index << (i*bits%(8*sizeof(Word)));
+				}
+			}
+		});
+
+		// concatenate the blocks
+		std::size_t numPaletteEntries = 0;
+		std::size_t numIndexWords     = 0;
+		for (std::size_t b = 0; b < numBlocks; b++) {
+
+			_blocks[b].paletteBegin = numPaletteEntries;
+			_blocks[b].indicesBegin = numIndexWords;
+			numPaletteEntries += palettes[b].size();
+			numIndexWords     += indices[b].size();
+		}
+
+		_palettes.resize(numPaletteEntries);
+		_indices.resize(numIndexWords);
+
+		parallelFor(0, numBlocks, [&](std::size_t begin, std::size_t end) {
+
+			for (std::size_t b = begin; b < end; b++) {
+
+				std::copy(palettes[b].begin(), palettes[b].end(), _palettes.begin() + _blocks[b].paletteBegin);
+				std::copy(indices[b].begin(),  indices[b].end(),  _indices.begin()  + _blocks[b].indicesBegin);
+			}
+		});
+	}
+
+	/**
+	 * Voxel access in constant time.
+	 */
+	ValueType operator[](util::point<unsigned int, 3> pos) const { return (*this)(pos.x(), pos.y(), pos.z()); }
+	ValueType operator()(unsigned int x, unsigned int y, unsigned int z) const {
+
+		const Block& block = _blocks[
+				x/BlockSize + _blocksX*(
+				y/BlockSize + _blocksY*(
+				z/BlockSize))];
+
+		return label(
+				block,
+				x%BlockSize + BlockSize*(
+				y%BlockSize + BlockSize*(
+				z%BlockSize)));
+	}
+
+	unsigned int width()  const { return _width; }
+	unsigned int height() const { return _height; }
+	unsigned int depth()  const { return _depth; }
+
+	/**
+	 * The memory used by the compressed representation in bytes.
+	 */
+	std::size_t getCompressedSize() const {
+
+		return
+				_blocks.size()*sizeof(Block) +
+				_palettes.size()*sizeof(ValueType) +
+				_indices.size()*sizeof(Word);
+	}
+
+	/**
+	 * Decompress this volume into an ExplicitVolume. Blocks are decompressed 
+	 * in parallel.
+	 */
+	ExplicitVolume<ValueType> decompress() const {
+
+		ExplicitVolume<ValueType> volume(_width, _height, _depth);
+		volume.setResolution(getResolution());
+		volume.setOffset(getOffset());
+
+		decompressRegion(
+				util::point<unsigned int, 3>(0, 0, 0),
+				util::point<unsigned int, 3>(_width, _height, _depth),
+				volume);
+
+		return volume;
+	}
+
+	/**
+	 * Decompress a subvolume of this volume. Only the blocks intersecting the 
+	 * subvolume will be decompressed.
+	 *
+	 * @param boundingBox
+	 *              The bounding box of the requested subvolume. The target gets 
+	 *              resized to be at least that large, but might be larger to 
+	 *              fit all the voxels that are intersecting the requested 
+	 *              subvolume.
+	 * @param target
+	 *              An explicit volume to fill.
+	 */
+	void cut(const util::box<float, 3>& boundingBox, ExplicitVolume<ValueType>& target) const {
+
+		util::point<unsigned int, 3> begin, end;
+
+		if (!getDiscreteRegion(boundingBox, begin, end)) {
+
+			target = ExplicitVolume<ValueType>();
+			return;
+		}
+
+		target = ExplicitVolume<ValueType>(
+				end.x() - begin.x(),
+				end.y() - begin.y(),
+				end.z() - begin.z());
+		target.setResolution(getResolution());
+		target.setOffset(getOffset() + begin*getResolution());
+
+		decompressRegion(begin, end, target);
+	}
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override {
+
+		return util::box<unsigned int,3>(0, 0, 0, _width, _height, _depth);
+	}
+
+private:
+
+	/**
+	 * Read the values of block b in block order. Voxels of border blocks that 
+	 * are outside the volume are set to the first value of the block. Returns 
+	 * the number of values read.
+	 */
+	unsigned int readBlock(const ExplicitVolume<ValueType>& volume, std::size_t b, ValueType* values) const {
+
+		unsigned int bx = b%_blocksX*BlockSize;
+		unsigned int by = b/_blocksX%_blocksY*BlockSize;
+		unsigned int bz = b/(_blocksX*_blocksY)*BlockSize;
+
+		unsigned int numValues = 0;
+		for (unsigned int z = bz; z < bz + BlockSize; z++)
+		for (unsigned int y = by; y < by + BlockSize; y++)
+		for (unsigned int x = bx; x < bx + BlockSize; x++) {
+
+			if (x < _width && y < _height && z < _depth)
+				values[numValues] = volume(x, y, z);
+			else
+				values[numValues] = values[0];
+
+			numValues++;
+		}
+
+		return numValues;
+	}
+
+	/**
+	 * Get the label of voxel i of a block.
+	 */
+	ValueType label(const Block& block, unsigned int i) const {
+
+		if (block.bits == 0)
+			return _palettes[block.paletteBegin];
+
+		const unsigned int wordBits = 8*sizeof(Word);
+
+		Word word  = _indices[block.indicesBegin + i*block.bits/wordBits];
+		Word mask  = (Word(1) << block.bits) - 1;
+		Word index = (word >> (i*block.bits%wordBits)) & mask;
+
+		return _palettes[block.paletteBegin + index];
+	}
+
+	/**
+	 * Decompress the voxels in [begin, end) into target, which is expected to 
+	 * be of size end - begin.
+	 */
+	void decompressRegion(
+			const util::point<unsigned int, 3>& begin,
+			const util::point<unsigned int, 3>& end,
+			ExplicitVolume<ValueType>& target) const {
+
+		parallelFor(begin.z(), end.z(), [&](std::size_t beginZ, std::size_t endZ) {
+
+			for (unsigned int z = beginZ; z < endZ; z++)
+			for (unsigned int y = begin.y(); y < end.y(); y++) {
+
+				// decompress the row blockwise
+				for (unsigned int x = begin.x(); x < end.x();) {
+
+					const Block& block = _blocks[
+							x/BlockSize + _blocksX*(
+							y/BlockSize + _blocksY*(
+							z/BlockSize))];
+
+					unsigned int rowBegin = BlockSize*(y%BlockSize + BlockSize*(z%BlockSize));
+					unsigned int blockEnd = std::min((x/BlockSize + 1)*BlockSize, end.x());
+
+					for (; x < blockEnd; x++)
+						target(
+								x - begin.x(),
+								y - begin.y(),
+								z - begin.z()) = label(block, rowBegin + x%BlockSize);
+				}
+			}
+		});
+	}
+
+	unsigned int _width;
+	unsigned int _height;
+	unsigned int _depth;
+
+	// the number of blocks in each direction
+	std::size_t _blocksX;
+	std::size_t _blocksY;
+	std::size_t _blocksZ;
+
+	std::vector<Block>     _blocks;
+	std::vector<ValueType> _palettes;
+	std::vector<Word>      _indices;
+};
+
+#endif // IMAGEPROCESSING_COMPRESSED_LABEL_VOLUME_H__
+
@@ -0,0 +1,273 @@
+#ifndef IMAGEPROCESSING_CONTINGENCY_TABLE_H__
+#define IMAGEPROCESSING_CONTINGENCY_TABLE_H__
+
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <util/exceptions.h>
+#include "ExplicitVolume.h"
+#include "parallel.h"
+
+/**
+ * The sparse overlap matrix of two label volumes A and B: the number of voxels
+ * for each pair of labels (a, b) that overlap in at least one voxel. Label 0 is
+ * treated like every other label.
+ */
+template <typename S, typename T>
+class ContingencyTable {
+
+public:
+
+	typedef std::pair<S, T> LabelPair;
+
+	struct LabelPairHash {
+
+		std::size_t operator()(const LabelPair& pair) const {
+
+			std::size_t a = std::hash<S>()(pair.first);
+			std::size_t b = std::hash<T>()(pair.second);
+
+			return a ^ (b + 0x9e3779b97f4a7c15ULL + (a << 6) + (a >> 2));
+		}
+	};
+
+	typedef std::unordered_map<LabelPair, std::size_t, LabelPairHash> Entries;
+
+	ContingencyTable() :
+		_total(0) {}
+
+	/**
+	 * Add count voxels to the pair (a, b).
+	 */
+	void add(S a, T b, std::size_t count = 1) {
+
+		_entries[LabelPair(a, b)] += count;
+		_sizesA[a] += count;
+		_sizesB[b] += count;
+		_total += count;
+	}
+
+	/**
+	 * Add all entries of another table.
+	 */
+	void add(const ContingencyTable& other) {
+
+		for (const auto& entry : other._entries)
+			_entries[entry.first] += entry.second;
+		for (const auto& size : other._sizesA)
+			_sizesA[size.first] += size.second;
+		for (const auto& size : other._sizesB)
+			_sizesB[size.first] += size.second;
+
+		_total += other._total;
+	}
+
+	/**
+	 * The number of voxels labelled a in A and b in B.
+	 */
+	std::size_t operator()(S a, T b) const {
+
+		typename Entries::const_iterator i = _entries.find(LabelPair(a, b));
+		return (i == _entries.end() ? 0 : i->second);
+	}
+
+	/**
+	 * All non-zero entries of the table.
+	 */
+	const Entries& entries() const { return _entries; }
+
+	/**
+	 * The number of voxels per label in A and B.
+	 */
+	const std::unordered_map<S, std::size_t>& sizesA() const { return _sizesA; }
+	const std::unordered_map<T, std::size_t>& sizesB() const { return _sizesB; }
+
+	/**
+	 * The total number of voxels.
+	 */
+	std::size_t total() const { return _total; }
+
+	/**
+	 * The variation of information between A and B, in bits. Sets split to the
+	 * conditional entropy H(B|A) and merge to H(A|B), which sum up to the
+	 * variation of information. With A as ground truth, they measure how much
+	 * B splits and merges its objects.
+	 */
+	double variationOfInformation(double& split, double& merge) const {
+
+		split = 0;
+		merge = 0;
+
+		if (_total == 0)
+			return 0;
+
+		const double n = _total;
+
+		for (const auto& entry : _entries) {
+
+			double pab = entry.second/n;
+			double pa  = _sizesA.find(entry.first.first)->second/n;
+			double pb  = _sizesB.find(entry.first.second)->second/n;
+
+			split -= pab*std::log2(pab/pa);
+			merge -= pab*std::log2(pab/pb);
+		}
+
+		return split + merge;
+	}
+
+	double variationOfInformation() const {
+
+		double split, merge;
+		return variationOfInformation(split, merge);
+	}
+
+	/**
+	 * The Rand index, the fraction of voxel pairs on which A and B agree
+	 * whether they belong to the same object.
+	 */
+	double randIndex() const {
+
+		double sumAB, sumA, sumB, pairs;
+		pairSums(sumAB, sumA, sumB, pairs);
+
+		if (pairs == 0)
+			return 1;
+
+		return (pairs + 2*sumAB - sumA - sumB)/pairs;
+	}
+
+	/**
+	 * The Rand index adjusted for chance.
+	 */
+	double adjustedRandIndex() const {
+
+		double sumAB, sumA, sumB, pairs;
+		pairSums(sumAB, sumA, sumB, pairs);
+
+		if (pairs == 0)
+			return 1;
+
+		double expected = sumA*sumB/pairs;
+		double maximal  = 0.5*(sumA + sumB);
+
+		if (maximal == expected)
+			return 1;
+
+		return (sumAB - expected)/(maximal - expected);
+	}
+
+	/**
+	 * For each label of A, the label of B with the largest overlap, and the
+	 * size of the overlap.
+	 */
+	std::unordered_map<S, std::pair<T, std::size_t> > bestMatchesA() const {
+
+		std::unordered_map<S, std::pair<T, std::size_t> > matches;
+		for (const auto& entry : _entries) {
+
+			std::pair<T, std::size_t>& match = matches[entry.first.first];
+			if (entry.second > match.second)
+				match = std::make_pair(entry.first.second, entry.second);
+		}
+
+		return matches;
+	}
+
+	/**
+	 * For each label of B, the label of A with the largest overlap, and the
+	 * size of the overlap.
+	 */
+	std::unordered_map<T, std::pair<S, std::size_t> > bestMatchesB() const {
+
+		std::unordered_map<T, std::pair<S, std::size_t> > matches;
+		for (const auto& entry : _entries) {
+
+			std::pair<S, std::size_t>& match = matches[entry.first.second];
+			if (entry.second > match.second)
+				match = std::make_pair(entry.first.first, entry.second);
+		}
+
+		return matches;
+	}
+
+private:
+
+	static double pairsOf(double n) { return 0.5*n*(n - 1); }
+
+	void pairSums(double& sumAB, double& sumA, double& sumB, double& pairs) const {
+
+		sumAB = sumA = sumB = 0;
+
+		for (const auto& entry : _entries)
+			sumAB += pairsOf(entry.second);
+		for (const auto& size : _sizesA)
+			sumA += pairsOf(size.second);
+		for (const auto& size : _sizesB)
+			sumB += pairsOf(size.second);
+
+		pairs = pairsOf(_total);
+	}
+
+	Entries _entries;
+
+	std::unordered_map<S, std::size_t> _sizesA;
+	std::unordered_map<T, std::size_t> _sizesB;
+
+	std::size_t _total;
+};
+
+/**
+ * Compute the contingency table of two label volumes of the same size in a
+ * single pass. Slabs along z are counted in parallel into separate tables,
+ * which are merged at the end. Runs of equal label pairs along x are counted
+ * at once.
+ */
+template <typename S, typename T>
+ContingencyTable<S, T>
+contingencyTable(const ExplicitVolume<S>& a, const ExplicitVolume<T>& b) {
+
+	if (a.width() != b.width() || a.height() != b.height() || a.depth() != b.depth())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"contingency tables can only be computed for volumes of the same size");
+
+	const unsigned int width  = a.width();
+	const unsigned int height = a.height();
+	const unsigned int depth  = a.depth();
+
+	const std::size_t numSlabs = std::max<std::size_t>(std::min<std::size_t>(numParallelThreads(), depth), 1);
+	std::vector<ContingencyTable<S, T> > slabTables(numSlabs);
+
+	parallelFor(0, numSlabs, [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (std::size_t s = beginSlab; s < endSlab; s++) {
+
+			ContingencyTable<S, T>& table = slabTables[s];
+
+			for (unsigned int z = s*depth/numSlabs; z < (s + 1)*depth/numSlabs; z++)
+			for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width;) {
+
+				S labelA = a(x, y, z);
+				T labelB = b(x, y, z);
+
+				unsigned int begin = x;
+				while (x < width && a(x, y, z) == labelA && b(x, y, z) == labelB)
+					x++;
+
+				table.add(labelA, labelB, x - begin);
+			}
+		}
+	},
+	1);
+
+	for (std::size_t s = 1; s < numSlabs; s++)
+		slabTables[0].add(slabTables[s]);
+
+	return std::move(slabTables[0]);
+}
+
+#endif // IMAGEPROCESSING_CONTINGENCY_TABLE_H__
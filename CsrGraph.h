@@ -0,0 +1,333 @@
+#ifndef IMAGEPROCESSING_CSR_GRAPH_H__
+#define IMAGEPROCESSING_CSR_GRAPH_H__
+
+#include <utility>
+#include <vector>
+#include <lemon/core.h>
+#include "IdVectorMap.h"
+
+/**
+ * A static undirected graph in compressed sparse row format. Nodes and edges
+ * are consecutive ids, the end points of the edges and the incident arcs of
+ * each node are stored in contiguous arrays. The graph is created once from a
+ * list of edges and can not be modified afterwards.
+ *
+ * Models the LEMON undirected graph concept, such that it can be used with
+ * LEMON algorithms like lemon::Dijkstra. Since the graph does not change, maps
+ * are plain vectors indexed by ids, see IdVectorMap.
+ */
+class CsrGraph {
+
+public:
+
+	typedef lemon::True UndirectedTag;
+	typedef lemon::True NodeNumTag;
+	typedef lemon::True EdgeNumTag;
+	typedef lemon::True ArcNumTag;
+
+	class Node {
+
+		friend class CsrGraph;
+
+	public:
+
+		Node() {}
+		Node(lemon::Invalid) : _id(-1) {}
+
+		bool operator==(const Node& other) const { return _id == other._id; }
+		bool operator!=(const Node& other) const { return _id != other._id; }
+		bool operator<(const Node& other)  const { return _id <  other._id; }
+
+	protected:
+
+		explicit Node(int id) : _id(id) {}
+
+		int _id;
+	};
+
+	class Edge {
+
+		friend class CsrGraph;
+
+	public:
+
+		Edge() {}
+		Edge(lemon::Invalid) : _id(-1) {}
+
+		bool operator==(const Edge& other) const { return _id == other._id; }
+		bool operator!=(const Edge& other) const { return _id != other._id; }
+		bool operator<(const Edge& other)  const { return _id <  other._id; }
+
+	protected:
+
+		explicit Edge(int id) : _id(id) {}
+
+		int _id;
+	};
+
+	/**
+	 * The two directions of edge e are the arcs 2e (from u to v) and 2e+1
+	 * (from v to u).
+	 */
+	class Arc {
+
+		friend class CsrGraph;
+
+	public:
+
+		Arc() {}
+		Arc(lemon::Invalid) : _id(-1) {}
+
+		operator Edge() const { return (_id < 0 ? Edge(lemon::INVALID) : Edge(_id/2)); }
+
+		bool operator==(const Arc& other) const { return _id == other._id; }
+		bool operator!=(const Arc& other) const { return _id != other._id; }
+		bool operator<(const Arc& other)  const { return _id <  other._id; }
+
+	protected:
+
+		explicit Arc(int id) : _id(id) {}
+
+		int _id;
+	};
+
+	class NodeIt : public Node {
+
+	public:
+
+		NodeIt() {}
+		NodeIt(lemon::Invalid) : Node(lemon::INVALID) {}
+		explicit NodeIt(const CsrGraph& graph) : Node(graph.nodeNum() > 0 ? 0 : -1), _graph(&graph) {}
+		NodeIt(const CsrGraph& graph, const Node& node) : Node(node), _graph(&graph) {}
+
+		NodeIt& operator++() { _id = (_id + 1 < _graph->nodeNum() ? _id + 1 : -1); return *this; }
+
+	private:
+
+		const CsrGraph* _graph;
+	};
+
+	class EdgeIt : public Edge {
+
+	public:
+
+		EdgeIt() {}
+		EdgeIt(lemon::Invalid) : Edge(lemon::INVALID) {}
+		explicit EdgeIt(const CsrGraph& graph) : Edge(graph.edgeNum() > 0 ? 0 : -1), _graph(&graph) {}
+		EdgeIt(const CsrGraph& graph, const Edge& edge) : Edge(edge), _graph(&graph) {}
+
+		EdgeIt& operator++() { _id = (_id + 1 < _graph->edgeNum() ? _id + 1 : -1); return *this; }
+
+	private:
+
+		const CsrGraph* _graph;
+	};
+
+	class ArcIt : public Arc {
+
+	public:
+
+		ArcIt() {}
+		ArcIt(lemon::Invalid) : Arc(lemon::INVALID) {}
+		explicit ArcIt(const CsrGraph& graph) : Arc(graph.arcNum() > 0 ? 0 : -1), _graph(&graph) {}
+		ArcIt(const CsrGraph& graph, const Arc& arc) : Arc(arc), _graph(&graph) {}
+
+		ArcIt& operator++() { _id = (_id + 1 < _graph->arcNum() ? _id + 1 : -1); return *this; }
+
+	private:
+
+		const CsrGraph* _graph;
+	};
+
+	/**
+	 * Iterates over the entries of the incidence list of a node. Base for the
+	 * incidence iterators below, which interpret the entries as outgoing arcs,
+	 * incoming arcs, or incident edges.
+	 */
+	class IncidenceIt {
+
+	protected:
+
+		IncidenceIt() {}
+		IncidenceIt(const CsrGraph& graph, const Node& node) :
+			_current(graph._arcs.data() + graph._offsets[CsrGraph::id(node)]),
+			_end(graph._arcs.data() + graph._offsets[CsrGraph::id(node) + 1]) {}
+
+		// the current arc, or -1 at the end
+		int arc() const { return (_current < _end ? *_current : -1); }
+
+		const int* _current;
+		const int* _end;
+	};
+
+	class OutArcIt : public Arc, private IncidenceIt {
+
+	public:
+
+		OutArcIt() {}
+		OutArcIt(lemon::Invalid) : Arc(lemon::INVALID) {}
+		OutArcIt(const CsrGraph& graph, const Node& node) : IncidenceIt(graph, node) { _id = arc(); }
+
+		OutArcIt& operator++() { ++_current; _id = arc(); return *this; }
+	};
+
+	class InArcIt : public Arc, private IncidenceIt {
+
+	public:
+
+		InArcIt() {}
+		InArcIt(lemon::Invalid) : Arc(lemon::INVALID) {}
+		InArcIt(const CsrGraph& graph, const Node& node) : IncidenceIt(graph, node) { _id = opposite(arc()); }
+
+		InArcIt& operator++() { ++_current; _id = opposite(arc()); return *this; }
+
+	private:
+
+		static int opposite(int arc) { return (arc < 0 ? -1 : arc^1); }
+	};
+
+	class IncEdgeIt : public Edge, private IncidenceIt {
+
+	public:
+
+		IncEdgeIt() {}
+		IncEdgeIt(lemon::Invalid) : Edge(lemon::INVALID) {}
+		IncEdgeIt(const CsrGraph& graph, const Node& node) : IncidenceIt(graph, node) { _id = edge(); }
+
+		IncEdgeIt& operator++() { ++_current; _id = edge(); return *this; }
+
+	private:
+
+		int edge() const { int a = arc(); return (a < 0 ? -1 : a/2); }
+	};
+
+	template <typename V>
+	class NodeMap : public IdVectorMap<CsrGraph, Node, V> {
+
+	public:
+
+		NodeMap() {}
+		explicit NodeMap(const CsrGraph& graph, const V& value = V()) : IdVectorMap<CsrGraph, Node, V>(graph.nodeNum(), value) {}
+		NodeMap(const CsrGraph& graph, std::vector<V>&& values) : IdVectorMap<CsrGraph, Node, V>(std::move(values)) { (void)graph; }
+	};
+
+	template <typename V>
+	class EdgeMap : public IdVectorMap<CsrGraph, Edge, V> {
+
+	public:
+
+		EdgeMap() {}
+		explicit EdgeMap(const CsrGraph& graph, const V& value = V()) : IdVectorMap<CsrGraph, Edge, V>(graph.edgeNum(), value) {}
+
+		// arcs are mapped to the values of their edges
+		using IdVectorMap<CsrGraph, Edge, V>::operator[];
+		typename IdVectorMap<CsrGraph, Edge, V>::Reference      operator[](const Arc& arc)       { return (*this)[Edge(arc)]; }
+		typename IdVectorMap<CsrGraph, Edge, V>::ConstReference operator[](const Arc& arc) const { return (*this)[Edge(arc)]; }
+	};
+
+	template <typename V>
+	class ArcMap : public IdVectorMap<CsrGraph, Arc, V> {
+
+	public:
+
+		ArcMap() {}
+		explicit ArcMap(const CsrGraph& graph, const V& value = V()) : IdVectorMap<CsrGraph, Arc, V>(graph.arcNum(), value) {}
+	};
+
+	/**
+	 * Create an empty graph.
+	 */
+	CsrGraph() : _offsets(1, 0) {}
+
+	/**
+	 * Create a graph with the given number of nodes and edges between the
+	 * nodes with ids us[i] and vs[i].
+	 */
+	CsrGraph(int numNodes, std::vector<int>&& us, std::vector<int>&& vs) :
+		_us(std::move(us)),
+		_vs(std::move(vs)) {
+
+		// count the incident arcs of each node
+		_offsets.assign(numNodes + 1, 0);
+		for (int e = 0; e < edgeNum(); e++) {
+
+			_offsets[_us[e] + 1]++;
+			_offsets[_vs[e] + 1]++;
+		}
+		for (int n = 0; n < numNodes; n++)
+			_offsets[n + 1] += _offsets[n];
+
+		// sort the outgoing arcs by their source node
+		std::vector<int> next(_offsets.begin(), _offsets.end() - 1);
+		_arcs.resize(_offsets.back());
+		for (int e = 0; e < edgeNum(); e++) {
+
+			_arcs[next[_us[e]]++] = 2*e;
+			_arcs[next[_vs[e]]++] = 2*e + 1;
+		}
+	}
+
+	int nodeNum() const { return static_cast<int>(_offsets.size()) - 1; }
+	int edgeNum() const { return _us.size(); }
+	int arcNum()  const { return 2*_us.size(); }
+
+	int maxNodeId() const { return nodeNum() - 1; }
+	int maxEdgeId() const { return edgeNum() - 1; }
+	int maxArcId()  const { return arcNum() - 1; }
+
+	static int id(const Node& node) { return node._id; }
+	static int id(const Edge& edge) { return edge._id; }
+	static int id(const Arc& arc)   { return arc._id; }
+
+	static Node nodeFromId(int id) { return Node(id); }
+	static Edge edgeFromId(int id) { return Edge(id); }
+	static Arc  arcFromId(int id)  { return Arc(id); }
+
+	Node u(const Edge& edge) const { return Node(_us[edge._id]); }
+	Node v(const Edge& edge) const { return Node(_vs[edge._id]); }
+
+	Node source(const Arc& arc) const { return Node(arc._id%2 == 0 ? _us[arc._id/2] : _vs[arc._id/2]); }
+	Node target(const Arc& arc) const { return Node(arc._id%2 == 0 ? _vs[arc._id/2] : _us[arc._id/2]); }
+
+	/**
+	 * True for the arc from u to v of its edge.
+	 */
+	static bool direction(const Arc& arc) { return arc._id%2 == 0; }
+	static Arc direct(const Edge& edge, bool forward) { return Arc(2*edge._id + (forward ? 0 : 1)); }
+	Arc direct(const Edge& edge, const Node& source) const { return direct(edge, u(edge) == source); }
+
+	static Arc oppositeArc(const Arc& arc) { return Arc(arc._id^1); }
+
+	Node oppositeNode(const Node& node, const Edge& edge) const {
+
+		return (_us[edge._id] == node._id ? Node(_vs[edge._id]) : Node(_us[edge._id]));
+	}
+
+	/**
+	 * The number of incident edges of a node, in constant time.
+	 */
+	int degree(const Node& node) const { return _offsets[node._id + 1] - _offsets[node._id]; }
+
+	/**
+	 * The number of bytes used by this graph.
+	 */
+	std::size_t memoryUsage() const {
+
+		return sizeof(int)*(_us.size() + _vs.size() + _offsets.size() + _arcs.size());
+	}
+
+private:
+
+	// end points of each edge
+	std::vector<int> _us;
+	std::vector<int> _vs;
+
+	// for each node, the position of its first outgoing arc in _arcs,
+	// followed by the total number of arcs
+	std::vector<int> _offsets;
+
+	// the outgoing arcs of all nodes, sorted by node
+	std::vector<int> _arcs;
+};
+
+#endif // IMAGEPROCESSING_CSR_GRAPH_H__
@@ -1,6 +1,8 @@
 #ifndef IMAGEPROCESSING_DISCRETIZATION_H__
 #define IMAGEPROCESSING_DISCRETIZATION_H__
 
+#include <cmath>
+#include <algorithm>
 #include <imageprocessing/Volume.h>
 
 /**
@@ -23,8 +25,23 @@ public:
 		Volume(other),
 		_res(other._res),
 		_offset(other._offset),
-		_discreteBoundingBox(other._discreteBoundingBox),
-		_discreteBoundingBoxDirty(other._discreteBoundingBoxDirty) {}
+		_discreteBoundingBoxDirty(true) {
+
+		copyDiscreteBoundingBox(other);
+	}
+
+	DiscreteVolume& operator=(const DiscreteVolume& other) {
+
+		if (this != &other) {
+
+			Volume::operator=(other);
+			_res    = other._res;
+			_offset = other._offset;
+			copyDiscreteBoundingBox(other);
+		}
+
+		return *this;
+	}
 
 	/**
 	 * Create a new discrete volume.
@@ -99,14 +116,94 @@ public:
 	}
 
 	/**
-	 * Get the discrete bounding box of this volume.
+	 * Transform a batch of real-valued volume locations into discrete
+	 * coordinates, as getDiscreteCoordinates() does for single locations. The
+	 * locations and coordinates are stored as consecutive (x,y,z) triples.
+	 * Coordinates outside of the discrete bounding box are clamped to it.
+	 *
+	 * @param locations
+	 *              Pointer to 3*n floats.
+	 * @param n
+	 *              The number of locations.
+	 * @param coordinates
+	 *              Pointer to 3*n unsigned ints to store the coordinates.
+	 * @param inside
+	 *              Optional pointer to n bools, set to whether a location is
+	 *              within the discrete bounding box.
+	 *
+	 * @return The number of locations outside of the discrete bounding box.
+	 */
+	std::size_t getDiscreteCoordinates(
+			const float*  locations,
+			std::size_t   n,
+			unsigned int* coordinates,
+			bool*         inside = 0) const {
+
+		// read everything needed once, such that the loop below can be
+		// vectorized
+		const util::box<float,3>&        bb  = getBoundingBox();
+		const util::box<unsigned int,3>& dbb = getDiscreteBoundingBox();
+
+		const float min[3]  = { bb.min().x(), bb.min().y(), bb.min().z() };
+		const float res[3]  = { _res.x(), _res.y(), _res.z() };
+		const float size[3] = { (float)dbb.width(), (float)dbb.height(), (float)dbb.depth() };
+		const float last[3] = { std::max(size[0] - 1, 0.0f), std::max(size[1] - 1, 0.0f), std::max(size[2] - 1, 0.0f) };
+
+		std::size_t numOutside = 0;
+
+		for (std::size_t i = 0; i < n; i++) {
+
+			bool in = true;
+
+			for (int d = 0; d < 3; d++) {
+
+				float c = (locations[3*i + d] - min[d])/res[d];
+
+				in = in && (c >= 0 && c < size[d]);
+				coordinates[3*i + d] = static_cast<unsigned int>(std::min(std::max(c, 0.0f), last[d]));
+			}
+
+			numOutside += !in;
+			if (inside)
+				inside[i] = in;
+		}
+
+		return numOutside;
+	}
+
+	/**
+	 * Transform a batch of discrete coordinates into real-valued locations, as
+	 * getRealLocation() does for single coordinates. The coordinates and
+	 * locations are stored as consecutive (x,y,z) triples.
+	 */
+	void getRealLocations(
+			const unsigned int* coordinates,
+			std::size_t         n,
+			float*              locations) const {
+
+		const float res[3]    = { _res.x(), _res.y(), _res.z() };
+		const float offset[3] = { _offset.x(), _offset.y(), _offset.z() };
+
+		for (std::size_t i = 0; i < 3*n; i += 3)
+			for (int d = 0; d < 3; d++)
+				locations[i + d] = coordinates[i + d]*res[d] + offset[d];
+	}
+
+	/**
+	 * Get the discrete bounding box of this volume. Safe to call from several 
+	 * threads at the same time, see Volume::getBoundingBox().
 	 */
 	const util::box<unsigned int,3>& getDiscreteBoundingBox() const {
 
-		if (_discreteBoundingBoxDirty) {
+		if (_discreteBoundingBoxDirty.load(std::memory_order_acquire)) {
+
+			std::lock_guard<std::mutex> lock(_discreteBoundingBoxMutex);
 
-			_discreteBoundingBox = computeDiscreteBoundingBox();
-			_discreteBoundingBoxDirty = false;
+			if (_discreteBoundingBoxDirty.load(std::memory_order_relaxed)) {
+
+				_discreteBoundingBox = computeDiscreteBoundingBox();
+				_discreteBoundingBoxDirty.store(false, std::memory_order_release);
+			}
 		}
 
 		return _discreteBoundingBox;
@@ -116,7 +213,7 @@ public:
 	 * Indicate that the bounding box changed and needs to be recomputed the 
 	 * next time it is queried.
 	 */
-	void setDiscreteBoundingBoxDirty() { _discreteBoundingBoxDirty = true; Volume::setBoundingBoxDirty(); }
+	void setDiscreteBoundingBoxDirty() { _discreteBoundingBoxDirty.store(true, std::memory_order_release); Volume::setBoundingBoxDirty(); }
 
 	/**
 	 * Fallback for subclasses.
@@ -125,6 +222,38 @@ public:
 
 protected:
 
+	/**
+	 * Get the discrete region of this volume that intersects with the given 
+	 * box. The region is given by its begin (inclusive) and end (exclusive) 
+	 * discrete coordinates, and might be larger than the box to fit all the 
+	 * voxels that are intersecting it.
+	 *
+	 * @return false, if the box does not intersect with this volume.
+	 */
+	bool getDiscreteRegion(
+			const util::box<float,3>&     box,
+			util::point<unsigned int,3>& begin,
+			util::point<unsigned int,3>& end) const {
+
+		util::box<float,3> intersection = box.intersection(getBoundingBox());
+
+		if (intersection.isZero())
+			return false;
+
+		// the discrete offset of the requested region in this volume
+		begin = (intersection.min() - getBoundingBox().min())/_res;
+
+		// the discrete size of the requested region, limited to the size of 
+		// this volume
+		const util::box<unsigned int,3>& dbb = getDiscreteBoundingBox();
+		end = util::point<unsigned int,3>(
+				std::min(begin.x() + (unsigned int)std::ceil(intersection.width() /_res.x()), dbb.width()),
+				std::min(begin.y() + (unsigned int)std::ceil(intersection.height()/_res.y()), dbb.height()),
+				std::min(begin.z() + (unsigned int)std::ceil(intersection.depth() /_res.z()), dbb.depth()));
+
+		return true;
+	}
+
 	/**
 	 * To be overwritten by subclasses to compute the discrete bounding box 
 	 * after it was set dirty.
@@ -140,6 +269,16 @@ protected:
 
 private:
 
+	void copyDiscreteBoundingBox(const DiscreteVolume& other) {
+
+		std::lock_guard<std::mutex> lock(other._discreteBoundingBoxMutex);
+
+		bool dirty = other._discreteBoundingBoxDirty.load(std::memory_order_acquire);
+		if (!dirty)
+			_discreteBoundingBox = other._discreteBoundingBox;
+		_discreteBoundingBoxDirty.store(dirty, std::memory_order_release);
+	}
+
 	util::point<float,3> _res;
 	util::point<float,3> _offset;
 
@@ -150,9 +289,15 @@ private:
 	mutable util::box<unsigned int,3> _discreteBoundingBox;
 
 	/**
-	 * Same for the dirty flag.
+	 * Same for the dirty flag, which publishes the bounding box to other 
+	 * threads once it is computed.
+	 */
+	mutable std::atomic<bool> _discreteBoundingBoxDirty;
+
+	/**
+	 * Serializes the computation of the discrete bounding box.
 	 */
-	mutable bool _discreteBoundingBoxDirty;
+	mutable std::mutex _discreteBoundingBoxMutex;
 };
 
 #endif // IMAGEPROCESSING_DISCRETIZATION_H__
@@ -1,7 +1,11 @@
 #ifndef IMAGEPROCESSING_EXPLICIT_VOLUME_H__
 #define IMAGEPROCESSING_EXPLICIT_VOLUME_H__
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <vector>
 #include <vigra/multi_array.hxx>
 #include <vigra/functorexpression.hxx>
 
@@ -15,22 +19,62 @@
 #include <util/exceptions.h>
 #include <util/typename.h>
 #include "DiscreteVolume.h"
+#include "ImageView.h"
+#include "ExplicitVolumeView.h"
+#include "blockedCopy.h"
+#include "parallel.h"
 
 template <typename T>
 struct numpy_type_traits {};
 
+template <>
+struct numpy_type_traits<std::uint8_t> {
+
+	static char getNumpyType() { return NPY_UINT8; }
+};
+
+template <>
+struct numpy_type_traits<std::uint16_t> {
+
+	static char getNumpyType() { return NPY_UINT16; }
+};
+
+template <>
+struct numpy_type_traits<std::uint32_t> {
+
+	static char getNumpyType() { return NPY_UINT32; }
+};
+
+template <>
+struct numpy_type_traits<std::uint64_t> {
+
+	static char getNumpyType() { return NPY_UINT64; }
+};
+
 template <>
 struct numpy_type_traits<int> {
 
 	static char getNumpyType() { return NPY_INT32; }
 };
 
+template <>
+struct numpy_type_traits<std::int64_t> {
+
+	static char getNumpyType() { return NPY_INT64; }
+};
+
 template <>
 struct numpy_type_traits<float> {
 
 	static char getNumpyType() { return NPY_FLOAT32; }
 };
 
+template <>
+struct numpy_type_traits<double> {
+
+	static char getNumpyType() { return NPY_FLOAT64; }
+};
+
 /**
  * Explicit representation of a discrete volume as a vigra multi-array.
  */
@@ -55,6 +99,18 @@ public:
 		DiscreteVolume(other),
 		_data(other.data()) {}
 
+	/**
+	 * Create a volume from a view on (type compatible) voxel data. The data 
+	 * will be copied.
+	 */
+	template <typename T>
+	explicit ExplicitVolume(const ExplicitVolumeView<T>& view) :
+		DiscreteVolume(view),
+		_data(view.data().shape()) {
+
+		blockedCopy(view.data(), _data);
+	}
+
 	/**
 	 * Create a new explicit volume of the given size.
 	 */
@@ -106,6 +162,36 @@ public:
 		return image;
 	}
 
+	/**
+	 * Get a view on a 2D section of this volume orthogonal to the given axis, 
+	 * without copying. See ImageView for the orientation and metadata of the 
+	 * section.
+	 *
+	 * @param axis
+	 *              The axis the section is orthogonal to (0, 1, or 2).
+	 * @param index
+	 *              The discrete coordinate of the section along axis.
+	 */
+	ImageView<ValueType> sliceView(int axis, unsigned int index) {
+
+		return ImageView<ValueType>(*this, data(), axis, index);
+	}
+
+	/**
+	 * Get views on the sections [begin, end) of this volume orthogonal to the 
+	 * given axis, without copying.
+	 */
+	std::vector<ImageView<ValueType> > sliceViews(int axis, unsigned int begin, unsigned int end) {
+
+		std::vector<ImageView<ValueType> > views;
+		views.reserve(end > begin ? end - begin : 0);
+
+		for (unsigned int i = begin; i < end; i++)
+			views.push_back(sliceView(axis, i));
+
+		return views;
+	}
+
 	/**
 	 * Get access to the vigra multi-array that contains the data of this 
 	 * volume.
@@ -139,22 +225,105 @@ public:
 	 */
 	void normalize() {
 
+		if (_data.size() == 0)
+			return;
+
 		ValueType min, max;
 		ValueType shift = 0;
-		data().minmax(&min, &max);
+		minmax(min, max);
 		if (min < 0) {
 			shift = -min;
 			max  += shift;
 		}
 		if (min >= 0 && max > 1.0 && max <= 255.0)
 			max = 255;
-		using namespace vigra::functor;
 		if (shift != 0 || max != 1.0)
+			shiftAndScale(shift, max);
+	}
+
+	/**
+	 * Find the minimal and maximal value of this volume. The volume must not 
+	 * be empty.
+	 */
+	void minmax(ValueType& min, ValueType& max) const {
+
+		std::mutex mutex;
+		min = max = *_data.data();
+
+		parallelFor(0, _data.size(), [this, &mutex, &min, &max](std::size_t begin, std::size_t end) {
+
+			// keep several independent minima and maxima, such that the 
+			// compiler can vectorize the loop
+			const std::size_t Lanes = 8;
+			const ValueType* data = _data.data();
+
+			ValueType mins[Lanes];
+			ValueType maxs[Lanes];
+			std::fill(mins, mins + Lanes, data[begin]);
+			std::fill(maxs, maxs + Lanes, data[begin]);
+
+			std::size_t i = begin;
+			for (; i + Lanes <= end; i += Lanes)
+				for (std::size_t l = 0; l < Lanes; l++) {
+
+					mins[l] = (data[i + l] < mins[l] ? data[i + l] : mins[l]);
+					maxs[l] = (data[i + l] > maxs[l] ? data[i + l] : maxs[l]);
+				}
+			for (; i < end; i++) {
+
+				mins[0] = (data[i] < mins[0] ? data[i] : mins[0]);
+				maxs[0] = (data[i] > maxs[0] ? data[i] : maxs[0]);
+			}
+
+			ValueType blockMin = *std::min_element(mins, mins + Lanes);
+			ValueType blockMax = *std::max_element(maxs, maxs + Lanes);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			min = std::min(min, blockMin);
+			max = std::max(max, blockMax);
+		},
+		MinParallelBlockSize);
+	}
+
+	/**
+	 * Replace every value v of this volume with f(v). The voxels are processed 
+	 * in parallel, f therefore has to be thread-safe.
+	 */
+	template <typename F>
+	void transform(F f) {
+
+		parallelFor(0, _data.size(), [this, &f](std::size_t begin, std::size_t end) {
+
+			ValueType* data = _data.data();
+			for (std::size_t i = begin; i < end; i++)
+				data[i] = f(data[i]);
+		},
+		MinParallelBlockSize);
+	}
+
+	/**
+	 * Replace every value v of this volume with (v + shift)/scale.
+	 */
+	void shiftAndScale(ValueType shift, ValueType scale) {
 
-			vigra::transformMultiArray(
-					data(),
-					data(),
-					(Arg1() + Param(shift))/Param(max));
+		transform([shift, scale](ValueType v) { return (v + shift)/scale; });
+	}
+
+	/**
+	 * Limit the values of this volume to the range [min, max].
+	 */
+	void clamp(ValueType min, ValueType max) {
+
+		transform([min, max](ValueType v) { return (v < min ? min : (v > max ? max : v)); });
+	}
+
+	/**
+	 * Replace every value of this volume with above, if it is at least the 
+	 * given threshold, and with below otherwise.
+	 */
+	void threshold(ValueType threshold, ValueType below = 0, ValueType above = 1) {
+
+		transform([threshold, below, above](ValueType v) { return (v >= threshold ? above : below); });
 	}
 
 	/**
@@ -162,13 +331,44 @@ public:
 	 */
 	void transpose() {
 
-		_data = _data.transpose();
+		permuteAxes(2, 1, 0);
+	}
+
+	/**
+	 * Permute the axises of this volume, such that axis i of the result is 
+	 * axis p_i of the current volume. Resolution and offset are permuted 
+	 * accordingly. The voxels are reordered blockwise and in parallel.
+	 */
+	void permuteAxes(int p0, int p1, int p2) {
+
+		const int p[3] = { p0, p1, p2 };
+
+		bool seen[3] = { false, false, false };
+		for (int i = 0; i < 3; i++) {
+
+			if (p[i] < 0 || p[i] > 2 || seen[p[i]])
+				UTIL_THROW_EXCEPTION(
+						UsageError,
+						"(" << p0 << ", " << p1 << ", " << p2 << ") is not a permutation of the axises");
+			seen[p[i]] = true;
+		}
+
+		if (p0 == 0 && p1 == 1 && p2 == 2)
+			return;
+
+		typedef typename data_type::difference_type Shape;
+		Shape shape(_data.shape(p0), _data.shape(p1), _data.shape(p2));
+		Shape stride(_data.stride(p0), _data.stride(p1), _data.stride(p2));
+
+		data_type permuted(shape);
+		blockedCopy(vigra::MultiArrayView<3, ValueType>(shape, stride, _data.data()), permuted);
+		_data.swap(permuted);
 
 		auto res = getResolution();
 		auto off = getOffset();
 
-		setResolution(res.z(), res.y(), res.x());
-		setOffset(off.z(), off.y(), off.x());
+		setResolution(res[p0], res[p1], res[p2]);
+		setOffset(off[p0], off[p1], off[p2]);
 		setBoundingBoxDirty();
 	}
 
@@ -185,39 +385,66 @@ public:
 	 */
 	void cut(const util::box<float, 3>& boundingBox, ExplicitVolume<ValueType>& target) {
 
-		util::box<float, 3> intersection = boundingBox.intersection(getBoundingBox());
+		util::point<unsigned int, 3> begin, end;
 
-		if (intersection.isZero()) {
+		if (!getDiscreteRegion(boundingBox, begin, end)) {
 
 			target = ExplicitVolume<ValueType>();
 			return;
 		}
 
-		// the discrete offset of the requested region in this volume
-		util::point<unsigned int, 3> offset =
-				(intersection.min() - getBoundingBox().min())/
-				getResolution();
-
-		// the discrete size of the requested region
-		util::point<unsigned int, 3> size(
-				std::ceil(intersection.width() /getResolution().x()),
-				std::ceil(intersection.height()/getResolution().y()),
-				std::ceil(intersection.depth() /getResolution().z()));
-
-		target = ExplicitVolume<ValueType>(size.x(), size.y(), size.z());
+		target = ExplicitVolume<ValueType>(
+				end.x() - begin.x(),
+				end.y() - begin.y(),
+				end.z() - begin.z());
 		target.setResolution(getResolution());
-		target.setOffset(getOffset() + offset*getResolution());
+		target.setOffset(getOffset() + begin*getResolution());
 
 		typedef typename data_type::difference_type Shape;
 		target.data() = data().subarray(
-				Shape(
-						offset.x(),
-						offset.y(),
-						offset.z()),
-				Shape(
-						offset.x() + size.x(),
-						offset.y() + size.y(),
-						offset.z() + size.z()));
+				Shape(begin.x(), begin.y(), begin.z()),
+				Shape(end.x(),   end.y(),   end.z()));
+	}
+
+	/**
+	 * Get a view on a subvolume of this ExplicitVolume<ValueType>, without 
+	 * copying voxels. The view refers to the data of this volume, which 
+	 * therefore has to outlive the view and must not be resized while the view 
+	 * is in use.
+	 *
+	 * @param boundingBox
+	 *              The bounding box of the requested subvolume. The view might 
+	 *              be larger to fit all the voxels that are intersecting the 
+	 *              requested subvolume.
+	 */
+	ExplicitVolumeView<ValueType> view(const util::box<float, 3>& boundingBox) {
+
+		util::point<unsigned int, 3> begin, end;
+
+		if (!getDiscreteRegion(boundingBox, begin, end))
+			return ExplicitVolumeView<ValueType>();
+
+		typedef typename data_type::difference_type Shape;
+		ExplicitVolumeView<ValueType> view(
+				data().subarray(
+						Shape(begin.x(), begin.y(), begin.z()),
+						Shape(end.x(),   end.y(),   end.z())));
+		view.setResolution(getResolution());
+		view.setOffset(getOffset() + begin*getResolution());
+
+		return view;
+	}
+
+	/**
+	 * Get a view on all of this ExplicitVolume<ValueType>.
+	 */
+	ExplicitVolumeView<ValueType> view() {
+
+		ExplicitVolumeView<ValueType> view(data());
+		view.setResolution(getResolution());
+		view.setOffset(getOffset());
+
+		return view;
 	}
 
 protected:
@@ -229,20 +456,119 @@ protected:
 
 private:
 
+	// don't use several threads for less voxels than this
+	static const std::size_t MinParallelBlockSize = 1 << 16;
+
 	data_type _data;
 };
 
 #ifdef HAVE_NUMPY
+/**
+ * Create a view on the voxels of a numpy array with axes (z,y,x), without 
+ * copying them. The array has to be of a type equivalent to ValueType, aligned, 
+ * and in native byte order. C-contiguous, Fortran-ordered, and other strided 
+ * arrays are supported.
+ *
+ * Read-only arrays are rejected, unless readOnly is set. The view is then 
+ * marked as read-only (see ExplicitVolumeView::isReadOnly()) and must only be 
+ * read from.
+ *
+ * The view shares ownership of the array, i.e., the array will stay alive as 
+ * long as the view (or copies of it) exist. The last copy of the view has to 
+ * be destructed while holding the GIL.
+ */
+template <typename ValueType>
+ExplicitVolumeView<ValueType>
+volumeViewFromNumpyArray(PyObject* a, bool readOnly = false) {
+
+	if (!PyArray_Check(a))
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"given object is not a numpy array");
+
+	PyArrayObject* array = (PyArrayObject*)a;
+
+	if (!PyArray_EquivTypenums(PyArray_TYPE(array), numpy_type_traits<ValueType>::getNumpyType()))
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"given numpy array is not of type " << typeName(ValueType()));
+
+	if (PyArray_NDIM(array) != 3)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"only arrays of dimensions 3 are supported.");
+
+	if (!PyArray_ISALIGNED(array) || !PyArray_ISNOTSWAPPED(array))
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"only aligned numpy arrays in native byte order can be viewed");
+
+	if (!readOnly && !PyArray_ISWRITEABLE(array))
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"given numpy array is read-only");
+
+	// numpy's (z,y,x) axes are our (x,y,z) axes, numpy strides are in bytes
+	vigra::Shape3 shape;
+	vigra::Shape3 stride;
+	for (int i = 0; i < 3; i++) {
+
+		npy_intp byteStride = PyArray_STRIDE(array, 2 - i);
+
+		if (byteStride%static_cast<npy_intp>(sizeof(ValueType)) != 0)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"strides of given numpy array are not a multiple of the size of " << typeName(ValueType()));
+
+		shape[i]  = PyArray_DIM(array, 2 - i);
+		stride[i] = byteStride/static_cast<npy_intp>(sizeof(ValueType));
+	}
+
+	Py_INCREF(a);
+	std::shared_ptr<void> owner(a, [](void* p) { Py_DECREF(static_cast<PyObject*>(p)); });
+
+	return ExplicitVolumeView<ValueType>(
+			typename ExplicitVolumeView<ValueType>::data_type(
+					shape,
+					stride,
+					static_cast<ValueType*>(PyArray_DATA(array))),
+			owner,
+			!PyArray_ISWRITEABLE(array));
+}
+
+/**
+ * Test whether the given object is a numpy array with elements of type 
+ * ValueType. Can be used to pick the matching volume type for an array, to 
+ * avoid conversions.
+ */
+template <typename ValueType>
+bool
+isNumpyArrayOfType(PyObject* a) {
+
+	return
+			PyArray_Check(a) &&
+			PyArray_EquivTypenums(
+					PyArray_TYPE((PyArrayObject*)a),
+					numpy_type_traits<ValueType>::getNumpyType());
+}
+
+/**
+ * Create an explicit volume from a numpy array with axes (z,y,x). Arrays of a 
+ * different type are converted by numpy first. The voxels are copied in a 
+ * single pass, blockwise to stay cache-friendly for any memory layout of the 
+ * array.
+ */
 template <typename ValueType>
 ExplicitVolume<ValueType>
 volumeFromNumpyArray(PyObject* a) {
 
+	// returns a new reference to a itself, if no conversion is needed
 	PyArray_Descr* desc = PyArray_DescrFromType(numpy_type_traits<ValueType>::getNumpyType());
-	PyArrayObject* array = (PyArrayObject*)PyArray_FromAny(
+	PyObject* array = PyArray_FromAny(
 			a,
 			desc,
 			0, 0, // min and max dimension, we check that later
-			0,    // requirements
+			NPY_ARRAY_ALIGNED | NPY_ARRAY_NOTSWAPPED,
 			0);
 
 	if (array == NULL)
@@ -250,24 +576,103 @@ volumeFromNumpyArray(PyObject* a) {
 				UsageError,
 				"given numpy array is not of type " << typeName(ValueType()));
 
-	int dims = PyArray_NDIM(array);
-	if (dims != 3)
-		UTIL_THROW_EXCEPTION(
-				UsageError,
-				"only arrays of dimensions 3 are supported.");
+	// the view holds its own reference to the array
+	ExplicitVolumeView<ValueType> view;
+	try {
+
+		// the voxels are only read
+		view = volumeViewFromNumpyArray<ValueType>(array, true);
+
+	} catch (...) {
+
+		Py_DECREF(array);
+		throw;
+	}
+	Py_DECREF(array);
+
+	return ExplicitVolume<ValueType>(view);
+}
+
+/**
+ * Create a numpy array with axes (z,y,x) on the given voxel data, without 
+ * copying it. The array keeps a copy of the given owner alive as long as it 
+ * exists. It is writeable, unless readOnly is set.
+ *
+ * @return A new reference to the numpy array, or NULL on failure.
+ */
+template <typename ValueType, typename Tag>
+PyObject*
+numpyArrayFromData(
+		const vigra::MultiArrayView<3, ValueType, Tag>& data,
+		std::shared_ptr<void> owner,
+		bool readOnly = false) {
+
+	npy_intp dims[3];
+	npy_intp strides[3];
+	for (int i = 0; i < 3; i++) {
+
+		dims[i]    = data.shape(2 - i);
+		strides[i] = data.stride(2 - i)*sizeof(ValueType);
+	}
+
+	PyObject* array = PyArray_New(
+			&PyArray_Type,
+			3, dims,
+			numpy_type_traits<ValueType>::getNumpyType(),
+			strides,
+			data.data(),
+			sizeof(ValueType),
+			NPY_ARRAY_ALIGNED | (readOnly ? 0 : NPY_ARRAY_WRITEABLE),
+			NULL);
+
+	if (array == NULL)
+		return NULL;
+
+	PyObject* base = PyCapsule_New(
+			new std::shared_ptr<void>(owner),
+			NULL,
+			[](PyObject* capsule) {
+				delete static_cast<std::shared_ptr<void>*>(PyCapsule_GetPointer(capsule, NULL));
+			});
+
+	if (base == NULL) {
+
+		Py_DECREF(array);
+		return NULL;
+	}
+
+	// steals the reference to base
+	if (PyArray_SetBaseObject((PyArrayObject*)array, base) != 0) {
 
-	size_t d = PyArray_DIM(array, 0);
-	size_t h = PyArray_DIM(array, 1);
-	size_t w = PyArray_DIM(array, 2);
+		Py_DECREF(array);
+		return NULL;
+	}
+
+	return array;
+}
 
-	auto volume = ExplicitVolume<ValueType>(w, h, d);
+/**
+ * Create a numpy array with axes (z,y,x) that shares the voxels of the given 
+ * volume. The array keeps the volume alive.
+ */
+template <typename ValueType>
+PyObject*
+numpyArrayFromVolume(std::shared_ptr<ExplicitVolume<ValueType>> volume) {
 
-	for (size_t z = 0; z < d; z++)
-	for (size_t y = 0; y < h; y++)
-	for (size_t x = 0; x < w; x++)
-		volume(x,y,z) = *static_cast<ValueType*>(PyArray_GETPTR3(array, z, y, x));
+	return numpyArrayFromData(volume->data(), volume);
+}
+
+/**
+ * Create a numpy array with axes (z,y,x) that shares the voxels of the given 
+ * view. The array keeps the owner of the view alive. If the view does not have 
+ * an owner, the memory it refers to has to outlive the array. Read-only views 
+ * give read-only arrays.
+ */
+template <typename ValueType>
+PyObject*
+numpyArrayFromVolume(const ExplicitVolumeView<ValueType>& view) {
 
-	return volume;
+	return numpyArrayFromData(view.data(), view.owner(), view.isReadOnly());
 }
 #endif
 
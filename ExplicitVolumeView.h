@@ -0,0 +1,225 @@
+#ifndef IMAGEPROCESSING_EXPLICIT_VOLUME_VIEW_H__
+#define IMAGEPROCESSING_EXPLICIT_VOLUME_VIEW_H__
+
+#include <memory>
+#include <vector>
+#include <vigra/multi_array.hxx>
+#include <imageprocessing/Image.h>
+#include "DiscreteVolume.h"
+#include "ImageView.h"
+
+template <typename ValueType>
+class ExplicitVolume;
+
+/**
+ * A discrete volume that refers to voxel data stored elsewhere, through a 
+ * (possibly strided) vigra multi-array view. The view can optionally share 
+ * ownership of the memory it refers to. Otherwise, the memory has to outlive 
+ * the view.
+ *
+ * Views can be used wherever an ExplicitVolume is only read, e.g., in 
+ * intersect() or to create a GraphVolume.
+ *
+ * Views on memory that must not be written to (like read-only memory mappings 
+ * or read-only numpy arrays) are marked as read-only. They must only be read 
+ * from, and are exported to numpy as read-only arrays.
+ */
+template <typename ValueType>
+class ExplicitVolumeView : public DiscreteVolume {
+
+public:
+
+	typedef ValueType                           value_type;
+	typedef vigra::MultiArrayView<3, ValueType> data_type;
+
+	/**
+	 * Create an empty view.
+	 */
+	ExplicitVolumeView() {}
+
+	/**
+	 * Create a view on the given data.
+	 *
+	 * @param data
+	 *              A multi-array view on the voxel data.
+	 * @param owner
+	 *              Optional shared ownership of the memory the view refers to.
+	 * @param readOnly
+	 *              Whether the memory the view refers to must not be written 
+	 *              to.
+	 */
+	explicit ExplicitVolumeView(
+			const data_type& data,
+			std::shared_ptr<void> owner = std::shared_ptr<void>(),
+			bool readOnly = false) :
+		_shape(data.shape()),
+		_stride(data.stride()),
+		_begin(data.data()),
+		_owner(owner),
+		_readOnly(readOnly) {}
+
+	/**
+	 * Pixel access.
+	 */
+	ValueType& operator[](vigra::Shape3 pos) const { return (*this)(pos[0], pos[1], pos[2]); }
+	ValueType& operator[](util::point<unsigned int, 3> pos) const { return (*this)(pos.x(), pos.y(), pos.z()); }
+	ValueType& operator()(unsigned int x, unsigned int y, unsigned int z) const {
+
+		return _begin[x*_stride[0] + y*_stride[1] + z*_stride[2]];
+	}
+
+	/**
+	 * 2D z-slice access.
+	 */
+	Image slice(int z) const {
+
+		vigra::MultiArrayView<2, ValueType> slice = data().template bind<2>(z);
+
+		Image image;
+		image = slice;
+		image.setResolution(
+				getResolutionX(),
+				getResolutionY(),
+				getResolutionZ());
+		image.setOffset(
+						getBoundingBox().min().x(),
+						getBoundingBox().min().y(),
+						getBoundingBox().min().z() + z*getResolutionZ());
+
+		return image;
+	}
+
+	/**
+	 * Get a view on a 2D section of this volume orthogonal to the given axis, 
+	 * without copying. See ImageView for the orientation and metadata of the 
+	 * section.
+	 *
+	 * @param axis
+	 *              The axis the section is orthogonal to (0, 1, or 2).
+	 * @param index
+	 *              The discrete coordinate of the section along axis.
+	 */
+	ImageView<ValueType> sliceView(int axis, unsigned int index) const {
+
+		return ImageView<ValueType>(*this, data(), axis, index, _owner);
+	}
+
+	/**
+	 * Get views on the sections [begin, end) of this volume orthogonal to the 
+	 * given axis, without copying.
+	 */
+	std::vector<ImageView<ValueType> > sliceViews(int axis, unsigned int begin, unsigned int end) const {
+
+		std::vector<ImageView<ValueType> > views;
+		views.reserve(end > begin ? end - begin : 0);
+
+		for (unsigned int i = begin; i < end; i++)
+			views.push_back(sliceView(axis, i));
+
+		return views;
+	}
+
+	/**
+	 * Get a vigra multi-array view on the data of this volume. Views are 
+	 * created on demand, since assigning to a vigra view copies voxels instead 
+	 * of rebinding it.
+	 */
+	data_type data() const { return data_type(_shape, _stride, _begin); }
+
+	/**
+	 * Get the (possibly empty) owner of the data.
+	 */
+	const std::shared_ptr<void>& owner() const { return _owner; }
+
+	/**
+	 * Test whether the memory of this view must not be written to.
+	 */
+	bool isReadOnly() const { return _readOnly; }
+
+	unsigned int width()  const { return _shape[0]; }
+	unsigned int height() const { return _shape[1]; }
+	unsigned int depth()  const { return _shape[2]; }
+
+	/**
+	 * Copy a subvolume of this view into an ExplicitVolume<ValueType>.
+	 *
+	 * @param boundingBox
+	 *              The bounding box of the requested subvolume. The target gets 
+	 *              resized to be at least that large, but might be larger to 
+	 *              fit all the voxels that are intersecting the requested 
+	 *              subvolume.
+	 * @param target
+	 *              An explicit volume to fill.
+	 */
+	void cut(const util::box<float, 3>& boundingBox, ExplicitVolume<ValueType>& target) const {
+
+		util::point<unsigned int, 3> begin, end;
+
+		if (!getDiscreteRegion(boundingBox, begin, end)) {
+
+			target = ExplicitVolume<ValueType>();
+			return;
+		}
+
+		target = ExplicitVolume<ValueType>(
+				end.x() - begin.x(),
+				end.y() - begin.y(),
+				end.z() - begin.z());
+		target.setResolution(getResolution());
+		target.setOffset(getOffset() + begin*getResolution());
+
+		typedef typename data_type::difference_type Shape;
+		target.data() = data().subarray(
+				Shape(begin.x(), begin.y(), begin.z()),
+				Shape(end.x(),   end.y(),   end.z()));
+	}
+
+	/**
+	 * Get a view on a subvolume of this view, without copying voxels. The new 
+	 * view shares the owner of this view, and is read-only if this view is.
+	 *
+	 * @param boundingBox
+	 *              The bounding box of the requested subvolume. The view might 
+	 *              be larger to fit all the voxels that are intersecting the 
+	 *              requested subvolume.
+	 */
+	ExplicitVolumeView view(const util::box<float, 3>& boundingBox) const {
+
+		util::point<unsigned int, 3> begin, end;
+
+		if (!getDiscreteRegion(boundingBox, begin, end))
+			return ExplicitVolumeView();
+
+		typedef typename data_type::difference_type Shape;
+		ExplicitVolumeView view(
+				data().subarray(
+						Shape(begin.x(), begin.y(), begin.z()),
+						Shape(end.x(),   end.y(),   end.z())),
+				_owner,
+				_readOnly);
+		view.setResolution(getResolution());
+		view.setOffset(getOffset() + begin*getResolution());
+
+		return view;
+	}
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override {
+
+		return util::box<unsigned int,3>(0, 0, 0, _shape[0], _shape[1], _shape[2]);
+	}
+
+private:
+
+	vigra::Shape3 _shape;
+	vigra::Shape3 _stride;
+	ValueType*    _begin = 0;
+
+	std::shared_ptr<void> _owner;
+
+	bool _readOnly = false;
+};
+
+#endif // IMAGEPROCESSING_EXPLICIT_VOLUME_VIEW_H__
+
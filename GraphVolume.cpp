@@ -1,24 +1,302 @@
 #include "GraphVolume.h"
+#include "RunLengthVolume.h"
+#include "connectivity.h"
+
+namespace {
+
+/**
+ * Call f(u, v) with the node ids of each pair of neighboring inside voxels of a 
+ * run-length volume, for the given connectivity. firstNodes contains the id of 
+ * the node of the first voxel of each run.
+ */
+template <typename F>
+void forEachRunEdge(
+		const RunLengthVolume& volume,
+		const std::vector<int>& firstNodes,
+		Connectivity connectivity,
+		F f) {
+
+	typedef RunLengthVolume::const_iterator const_iterator;
+
+	const_iterator runs = volume.begin(0, 0);
+
+	std::vector<util::point<int,3> > offsets = getPrecedingNeighborOffsets(connectivity);
+
+	for (unsigned int z = 0; z < volume.depth(); z++)
+	for (unsigned int y = 0; y < volume.height(); y++)
+	for (const util::point<int,3>& offset : offsets) {
+
+		int ny = static_cast<int>(y) + offset.y();
+		int nz = static_cast<int>(z) + offset.z();
+		int dx = offset.x();
+
+		if (ny < 0 || nz < 0 || ny >= static_cast<int>(volume.height()) || nz >= static_cast<int>(volume.depth()))
+			continue;
+
+		const_iterator b    = volume.begin(ny, nz);
+		const_iterator bEnd = volume.end(ny, nz);
+
+		for (const_iterator a = volume.begin(y, z); a != volume.end(y, z); a++) {
+
+			// skip runs that end before a, after shifting them by dx
+			while (b != bEnd && static_cast<int>(b->end) - dx <= static_cast<int>(a->begin))
+				b++;
+
+			// visit all voxels x of a where x + dx is in one of the next runs
+			for (const_iterator n = b; n != bEnd && static_cast<int>(n->begin) - dx < static_cast<int>(a->end); n++) {
+
+				int begin = std::max(static_cast<int>(a->begin), static_cast<int>(n->begin) - dx);
+				int end   = std::min(static_cast<int>(a->end),   static_cast<int>(n->end)   - dx);
+
+				for (int x = begin; x < end; x++)
+					f(
+							firstNodes[a - runs] + (x - a->begin),
+							firstNodes[n - runs] + (x + dx - n->begin));
+			}
+		}
+	}
+}
+
+} // anonymous namespace
 
 GraphVolume::GraphVolume() {}
 
-GraphVolume::GraphVolume(const GraphVolume& other) :
-	DiscreteVolume(other) {
-	copy(other);
+GraphVolume::GraphVolume(Connectivity connectivity) :
+	_connectivity(connectivity) {}
+
+GraphVolume::GraphVolume(std::shared_ptr<Data> data) :
+	_data(std::move(data)) {}
+
+GraphVolume::GraphVolume(const RunLengthVolume& volume, Connectivity connectivity) :
+	_connectivity(connectivity) {
+
+	// the nodes of each run get consecutive ids
+	std::vector<int> firstNodes(volume.numRuns() + 1, 0);
+	RunLengthVolume::const_iterator runs = volume.begin(0, 0);
+	for (std::size_t i = 0; i < volume.numRuns(); i++)
+		firstNodes[i + 1] = firstNodes[i] + (runs[i].end - runs[i].begin);
+
+	int numEdges = 0;
+	forEachRunEdge(volume, firstNodes, connectivity, [&](int, int) { numEdges++; });
+
+	Graph& graph = _data->graph;
+
+	graph.reserveNode(firstNodes.back());
+	graph.reserveEdge(numEdges);
+
+	for (unsigned int z = 0; z < volume.depth(); z++)
+	for (unsigned int y = 0; y < volume.height(); y++)
+	for (RunLengthVolume::const_iterator run = volume.begin(y, z); run != volume.end(y, z); run++)
+	for (unsigned int x = run->begin; x < run->end; x++)
+		_data->positions[graph.addNode()] = Position(x, y, z);
+
+	forEachRunEdge(volume, firstNodes, connectivity, [&](int u, int v) {
+		graph.addEdge(graph.nodeFromId(u), graph.nodeFromId(v));
+	});
+
+	setOffset(volume.getOffset());
+	setResolution(volume.getResolution());
 }
 
+GraphVolume::GraphVolume(const GraphVolume& other) :
+	DiscreteVolume(other),
+	_data(other._data),
+	_connectivity(other._connectivity) {}
+
 GraphVolume&
 GraphVolume::operator=(const GraphVolume& other) {
 	DiscreteVolume::operator=(other);
-	copy(other);
+	_data = other._data;
+	_connectivity = other._connectivity;
 	return *this;
 }
 
 void
-GraphVolume::copy(const GraphVolume& other) {
-	lemon::GraphCopy<Graph, Graph> copy(other.graph(), *_graph);
-	copy.nodeMap(other.positions(), *_positions);
-	copy.run();
+GraphVolume::detach() {
+
+	if (isShared())
+		_data = _data->clone();
+}
+
+std::unique_ptr<GraphVolume::Data>
+GraphVolume::Data::clone() const {
+
+	std::unique_ptr<Data> data(new Data);
+	copyTo(*data);
+
+	return data;
+}
+
+void
+GraphVolume::Data::copyTo(Data& data) const {
+
+	const int maxNodeId = graph.maxNodeId();
+	const int maxEdgeId = graph.maxEdgeId();
+
+	data.graph.reserveNode(maxNodeId + 1);
+	data.graph.reserveEdge(maxEdgeId + 1);
+
+	// nodes and edges of a new graph get consecutive ids, add them in order 
+	// of their ids with placeholders for unused ids
+
+	std::vector<Node> unusedNodes;
+	for (int id = 0; id <= maxNodeId; id++) {
+
+		Node node = data.graph.addNode();
+
+		if (graph.valid(graph.nodeFromId(id)))
+			data.positions[node] = positions[graph.nodeFromId(id)];
+		else
+			unusedNodes.push_back(node);
+	}
+
+	std::vector<Edge> unusedEdges;
+	for (int id = 0; id <= maxEdgeId; id++) {
+
+		Edge edge = graph.edgeFromId(id);
+
+		if (graph.valid(edge)) {
+
+			data.graph.addEdge(graph.u(edge), graph.v(edge));
+
+		} else {
+
+			Node any = data.graph.nodeFromId(0);
+			unusedEdges.push_back(data.graph.addEdge(any, any));
+		}
+	}
+
+	for (const Edge& edge : unusedEdges)
+		data.graph.erase(edge);
+	for (const Node& node : unusedNodes)
+		data.graph.erase(node);
+}
+
+GraphVolume::Node
+GraphVolume::nodeAt(const Position& position) const {
+
+	Node node;
+	nodesAt(&position, 1, &node);
+
+	return node;
+}
+
+void
+GraphVolume::nodesAt(const Position* positions, std::size_t n, Node* nodes) const {
+
+	std::shared_ptr<const NodeIndex> index = nodeIndex();
+
+	for (int attempt = 0; attempt < 2; attempt++) {
+
+		std::atomic<bool> consistent(true);
+
+		parallelFor(0, n, [&](std::size_t begin, std::size_t end) {
+
+			for (std::size_t i = begin; i < end; i++) {
+
+				int id;
+				if (!findNodeId(*index, positions[i], id))
+					consistent.store(false, std::memory_order_relaxed);
+
+				nodes[i] = (id >= 0 ? graph().nodeFromId(id) : Node(lemon::INVALID));
+			}
+		},
+		1 << 14);
+
+		if (consistent)
+			return;
+
+		// nodes were removed, or a position was changed through a reference 
+		// obtained before the index was created: recreate the index
+		_data->version.fetch_add(1, std::memory_order_relaxed);
+		index = nodeIndex();
+	}
+
+	// the index is still inconsistent, search the graph for the positions it 
+	// failed on
+	for (std::size_t i = 0; i < n; i++) {
+
+		int id;
+		if (findNodeId(*index, positions[i], id))
+			continue;
+
+		nodes[i] = Node(lemon::INVALID);
+		for (NodeIt node(graph()); node != lemon::INVALID; ++node)
+			if (this->positions()[node] == positions[i]) {
+
+				nodes[i] = node;
+				break;
+			}
+	}
+}
+
+std::shared_ptr<const GraphVolume::NodeIndex>
+GraphVolume::nodeIndex() const {
+
+	const Data& data = *_data;
+
+	// a changed maximal node id indicates that nodes were added
+	auto upToDate = [&](const std::shared_ptr<const NodeIndex>& index) {
+
+		return
+				index &&
+				index->version == data.version.load(std::memory_order_relaxed) &&
+				index->maxNodeId == data.graph.maxNodeId();
+	};
+
+	std::shared_ptr<const NodeIndex> index = std::atomic_load(&data.nodeIndex);
+	if (upToDate(index))
+		return index;
+
+	std::lock_guard<std::mutex> lock(data.nodeIndexMutex);
+
+	// another thread might have recreated it in the meantime
+	index = std::atomic_load(&data.nodeIndex);
+	if (upToDate(index))
+		return index;
+
+	std::shared_ptr<NodeIndex> newIndex = std::make_shared<NodeIndex>();
+	newIndex->version   = data.version.load(std::memory_order_relaxed);
+	newIndex->maxNodeId = data.graph.maxNodeId();
+
+	util::box<unsigned int,3> bb;
+	std::size_t numNodes = 0;
+	for (NodeIt node(data.graph); node != lemon::INVALID; ++node) {
+
+		bb.fit(util::box<unsigned int,3>(data.positions[node], data.positions[node] + Position(1, 1, 1)));
+		numNodes++;
+	}
+
+	newIndex->index = PositionIndex(bb, numNodes);
+	for (NodeIt node(data.graph); node != lemon::INVALID; ++node)
+		newIndex->index.insert(data.positions[node], data.graph.id(node));
+
+	index = newIndex;
+	std::atomic_store(&data.nodeIndex, index);
+
+	return index;
+}
+
+bool
+GraphVolume::findNodeId(const NodeIndex& index, const Position& position, int& id) const {
+
+	id = index.index.find(position);
+
+	if (id >= 0 && !isNodeAt(id, position)) {
+
+		id = -1;
+		return false;
+	}
+
+	return true;
+}
+
+bool
+GraphVolume::isNodeAt(int id, const Position& position) const {
+
+	Node node = graph().nodeFromId(id);
+
+	return graph().valid(node) && positions()[node] == position;
 }
 
 util::box<unsigned int,3>
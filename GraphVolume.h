@@ -1,16 +1,40 @@
 #ifndef IMAGEPROCESSING_GRAPH_VOLUME_H__
 #define IMAGEPROCESSING_GRAPH_VOLUME_H__
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "ExplicitVolume.h"
+#include "PositionIndex.h"
+#include "connectivity.h"
+#include "parallel.h"
 #include <lemon/list_graph.h>
 #define WITH_LEMON
 #include <vigra/tinyvector.hxx>
 #include <vigra/multi_gridgraph.hxx>
 
+class RunLengthVolume;
+
 /**
  * A volume represented by nodes and edges on a 3D grid. Provides a node map to 
  * store the 3D grid positions of the nodes.
+ *
+ * Copies of a graph volume share the graph and the node maps, until one of 
+ * them is modified (copy-on-write). Copying is therefore cheap, and read-only 
+ * copies do not need extra memory. graph() and positions() on a const graph 
+ * volume give read-only access without copying. mutableGraph() and 
+ * mutablePositions() (as well as the deprecated non-const graph() and 
+ * positions()) make a deep copy of shared data first, such that references 
+ * obtained from them stay valid only until this graph volume is copied again. 
+ * Node and edge ids are preserved by the copy.
+ *
+ * Nodes can be found by their positions in constant time, see nodeAt().
+ *
+ * Attaching a map to a graph registers the map with the graph, which is not 
+ * thread-safe. Since copies share their graph, call detach() on copies that 
+ * are used from different threads before attaching maps to their graphs 
+ * (Skeletonize does so for shared graph volumes).
  */
 class GraphVolume : public DiscreteVolume {
 
@@ -24,12 +48,33 @@ public:
 	typedef Graph::IncEdgeIt IncEdgeIt;
 
 	typedef util::point<unsigned int,3> Position;
-	typedef Graph::NodeMap<Position>    Positions;
 
 	/**
-	 * Size of neighborhood of a node.
+	 * A node map of positions. Non-const access counts as modification, such 
+	 * that the index from positions to nodes (see nodeAt()) gets recreated.
 	 */
-	static const int NumNeighbors = 26;
+	class Positions : public Graph::NodeMap<Position> {
+
+	public:
+
+		typedef Graph::NodeMap<Position> Base;
+
+		Positions(const Graph& graph, std::atomic<unsigned long>& version) :
+			Base(graph),
+			_version(version) {}
+
+		Position& operator[](const Node& node) { modified(); return Base::operator[](node); }
+		const Position& operator[](const Node& node) const { return Base::operator[](node); }
+
+		void set(const Node& node, const Position& position) { modified(); Base::set(node, position); }
+
+	private:
+
+		// modifications are not thread-safe anyway, a plain increment suffices
+		void modified() { _version.store(_version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+		std::atomic<unsigned long>& _version;
+	};
 
 	/**
 	 * Create an empty graph volume.
@@ -37,10 +82,32 @@ public:
 	GraphVolume();
 
 	/**
-	 * Create a graph volume from an explicit volume.
+	 * Create an empty graph volume, for nodes that are connected according to 
+	 * the given connectivity.
+	 */
+	explicit GraphVolume(Connectivity connectivity);
+
+	/**
+	 * Create a graph volume from an explicit volume. Nodes and edges are counted 
+	 * in parallel slabs, within the bounding box of the non-zero voxels only, 
+	 * and added in a single scan. Neighboring voxels are connected according to 
+	 * the given connectivity.
 	 */
 	template <typename T>
-	explicit GraphVolume(const ExplicitVolume<T>& volume);
+	explicit GraphVolume(const ExplicitVolume<T>& volume, Connectivity connectivity = Connectivity26) { createFromVolume(volume, connectivity); }
+
+	/**
+	 * Create a graph volume from a view on an explicit volume.
+	 */
+	template <typename T>
+	explicit GraphVolume(const ExplicitVolumeView<T>& volume, Connectivity connectivity = Connectivity26) { createFromVolume(volume, connectivity); }
+
+	/**
+	 * Create a graph volume from a run-length encoded volume. Nodes and edges 
+	 * are found by sweeping over the runs of neighboring rows, without 
+	 * visiting background voxels.
+	 */
+	explicit GraphVolume(const RunLengthVolume& volume, Connectivity connectivity = Connectivity26);
 
 	/**
 	 * Move constructor.
@@ -48,65 +115,312 @@ public:
 	GraphVolume(GraphVolume&& other) = default;
 
 	/**
-	 * Copy constructor.
+	 * Copy constructor. Shares the graph and node maps with other.
 	 */
 	GraphVolume(const GraphVolume& other);
 
 	/**
-	 * Assignment operator.
+	 * Assignment operator. Shares the graph and node maps with other.
 	 */
 	GraphVolume& operator=(const GraphVolume& other);
 
-	Graph& graph() { return *_graph; }
-	const Graph& graph() const { return *_graph; }
+	const Graph& graph() const { return _data->graph; }
+
+	const Positions& positions() const { return _data->positions; }
 
-	Positions& positions() { return *_positions; }
-	const Positions& positions() const { return *_positions; }
+	/**
+	 * Get the graph and positions for modification. Makes a deep copy first, if 
+	 * they are shared with other graph volumes.
+	 */
+	Graph& mutableGraph() { return data().graph; }
+	Positions& mutablePositions() { return data().positions; }
+
+	/**
+	 * Deprecated, use mutableGraph() and mutablePositions(), or the const 
+	 * versions for reading. Make a deep copy of shared data, even if only used 
+	 * for reading.
+	 */
+	Graph& graph() { return mutableGraph(); }
+	Positions& positions() { return mutablePositions(); }
+
+	/**
+	 * Find the node at the given position. Returns lemon::INVALID, if there is 
+	 * none, and one of the nodes if there are several.
+	 *
+	 * An index from positions to nodes is created on the first call, which 
+	 * makes this and all further lookups constant time. The index is shared 
+	 * between copies. It is recreated on the next lookup after positions were 
+	 * written through a Positions map (also through one obtained before the 
+	 * index was created), or after nodes were added. Found nodes are checked 
+	 * against the graph, such that removed nodes are never returned. Only 
+	 * positions changed through a reference to a single position, obtained 
+	 * before the index was created, are not noticed.
+	 *
+	 * Safe to call from several threads at the same time, but not while the 
+	 * graph volume is modified.
+	 */
+	Node nodeAt(const Position& position) const;
+
+	/**
+	 * Find the nodes at n positions, as nodeAt() does for single positions. 
+	 * Large batches are processed in parallel. Prefer this over nodeAt() for 
+	 * many positions, it accesses the shared index only once.
+	 */
+	void nodesAt(const Position* positions, std::size_t n, Node* nodes) const;
+
+	/**
+	 * Make sure that the graph and node maps of this graph volume are not 
+	 * shared with any copy, by creating a deep copy if they are.
+	 */
+	void detach();
+
+	/**
+	 * Test whether the graph and node maps of this graph volume are shared with 
+	 * a copy.
+	 */
+	bool isShared() const { return _data.use_count() > 1; }
+
+	/**
+	 * The connectivity this graph volume was created with.
+	 */
+	Connectivity getConnectivity() const { return _connectivity; }
+
+	/**
+	 * Size of neighborhood of a node.
+	 */
+	int numNeighbors() const { return _connectivity; }
+
+	/**
+	 * Size of neighborhood of a node for the default connectivity. Deprecated, 
+	 * use numNeighbors(), which takes the connectivity into account.
+	 */
+	static const int NumNeighbors = 26;
 
 protected:
 
-	util::box<unsigned int,3> computeDiscreteBoundingBox() const override;
+	/**
+	 * An index from positions to node ids, for a version of the positions and 
+	 * a maximal node id of the graph.
+	 */
+	struct NodeIndex {
 
-	void copy(const GraphVolume& other);
+		PositionIndex index;
+		unsigned long version;
+		int           maxNodeId;
+	};
 
-private:
-	std::unique_ptr<Graph>     _graph{new Graph};
-	std::unique_ptr<Positions> _positions{new Positions(*_graph)};
-};
+	/**
+	 * The graph and node maps of a graph volume, shared between copies. 
+	 * Subclasses with more node maps extend it and override clone().
+	 */
+	struct Data {
 
-template <typename T>
-GraphVolume::GraphVolume(const ExplicitVolume<T>& volume) {
-	vigra::MultiArray<3, Graph::Node> nodeIds(volume.data().shape());
-	vigra::GridGraph<3> grid(volume.data().shape(), vigra::IndirectNeighborhood);
+		Data() : version(0), positions(graph, version) {}
 
-	// add all non-background nodes
-	for (vigra::GridGraph<3>::NodeIt node(grid); node != lemon::INVALID; ++node) {
+		virtual ~Data() {}
 
-		if (volume[node] == 0)
-			continue;
+		/**
+		 * Create a deep copy of this data. Node and edge ids are preserved, 
+		 * such that nodes and edges of this data are valid in the copy.
+		 */
+		virtual std::unique_ptr<Data> clone() const;
 
-		Graph::Node n = _graph->addNode();
-		nodeIds[node] = n;
-		(*_positions)[n] = Position((*node)[0], (*node)[1], (*node)[2]);
-	}
+		/**
+		 * Copy the graph and positions into the given empty data, preserving 
+		 * node and edge ids. No maps are attached to this graph, such that 
+		 * several threads can copy the same data concurrently.
+		 */
+		void copyTo(Data& data) const;
 
-	// add all edges between non-background nodes
-	for (vigra::GridGraph<3>::EdgeIt edge(grid); edge != lemon::INVALID; ++edge) {
+		Graph graph;
 
-		int insideVoxels = (volume[grid.u(edge)] != 0) + (volume[grid.v(edge)] != 0);
+		// counts the modifications of the positions
+		mutable std::atomic<unsigned long> version;
 
-		if (insideVoxels == 2) {
+		Positions positions;
 
-			Graph::Node u = nodeIds[grid.u(edge)];
-			Graph::Node v = nodeIds[grid.v(edge)];
+		// index from positions to node ids, created on demand and replaced as 
+		// a whole, such that readers can keep using an outdated one
+		mutable std::shared_ptr<const NodeIndex> nodeIndex;
+		mutable std::mutex                       nodeIndexMutex;
+	};
 
-			_graph->addEdge(u, v);
-		}
+	/**
+	 * Create an empty graph volume with the given (subclass of) data.
+	 */
+	explicit GraphVolume(std::shared_ptr<Data> data);
+
+	/**
+	 * Get the data of this graph volume. The non-const version detaches 
+	 * first.
+	 */
+	Data& data() {
+
+		detach();
+		return *_data;
 	}
+	const Data& data() const { return *_data; }
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override;
+
+private:
+
+	template <typename VolumeType>
+	void createFromVolume(const VolumeType& volume, Connectivity connectivity);
+
+	/**
+	 * Get the index from positions to node ids, (re)create it if it is missing 
+	 * or outdated.
+	 */
+	std::shared_ptr<const NodeIndex> nodeIndex() const;
+
+	/**
+	 * Find the node id of a position with the given index. Returns false, if 
+	 * the index is inconsistent with the graph for this position.
+	 */
+	bool findNodeId(const NodeIndex& index, const Position& position, int& id) const;
+
+	/**
+	 * Check whether the node id found for a position is a valid node at this 
+	 * position.
+	 */
+	bool isNodeAt(int id, const Position& position) const;
+
+	std::shared_ptr<Data> _data{std::make_shared<Data>()};
+
+	Connectivity _connectivity = Connectivity26;
+};
+
+template <typename VolumeType>
+void
+GraphVolume::createFromVolume(const VolumeType& volume, Connectivity connectivity) {
+
+	const int width  = volume.width();
+	const int height = volume.height();
+	const int depth  = volume.depth();
 
 	// our (0,0,0) would be at the same location as volume's (0,0,0)
 	setOffset(volume.getOffset());
 	setResolution(volume.getResolution());
+
+	_connectivity = connectivity;
+
+	// find the bounding box of the foreground in parallel slabs
+	std::vector<util::box<int,3> > slabBoxes(std::max<std::size_t>(numParallelThreads(), 1));
+	parallelFor(0, slabBoxes.size(), [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (std::size_t s = beginSlab; s < endSlab; s++)
+		for (int z = s*depth/slabBoxes.size(); z < static_cast<int>((s + 1)*depth/slabBoxes.size()); z++)
+		for (int y = 0; y < height; y++) {
+
+			int first = -1;
+			int last  = -1;
+			for (int x = 0; x < width; x++)
+				if (volume(x, y, z) != 0) {
+
+					first = (first < 0 ? x : first);
+					last  = x;
+				}
+
+			if (first >= 0)
+				slabBoxes[s].fit(util::box<int,3>(first, y, z, last + 1, y + 1, z + 1));
+		}
+	},
+	1);
+
+	util::box<int,3> bb;
+	for (const util::box<int,3>& slabBox : slabBoxes)
+		if (!slabBox.isZero())
+			bb.fit(slabBox);
+
+	if (bb.isZero())
+		return;
+
+	const std::vector<util::point<int,3> > neighbors = getPrecedingNeighborOffsets(connectivity);
+
+	// split the bounding box into slabs along z, in which nodes and edges are 
+	// counted in parallel
+	const int numSlabs = std::min<int>(std::max<std::size_t>(numParallelThreads(), 1), bb.depth());
+	std::vector<std::size_t> slabNodes(numSlabs, 0);
+	std::vector<std::size_t> slabEdges(numSlabs, 0);
+
+	auto inside = [&](int x, int y, int z) {
+
+		return
+				x >= bb.min().x() && x < bb.max().x() &&
+				y >= bb.min().y() && y < bb.max().y() &&
+				z >= bb.min().z() && z < bb.max().z() &&
+				volume(x, y, z) != 0;
+	};
+
+	parallelFor(0, numSlabs, [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (std::size_t s = beginSlab; s < endSlab; s++)
+		for (int z = bb.min().z() + static_cast<long>(s)*bb.depth()/numSlabs; z < bb.min().z() + static_cast<long>(s + 1)*bb.depth()/numSlabs; z++)
+		for (int y = bb.min().y(); y < bb.max().y(); y++)
+		for (int x = bb.min().x(); x < bb.max().x(); x++) {
+
+			if (volume(x, y, z) == 0)
+				continue;
+
+			slabNodes[s]++;
+
+			for (const util::point<int,3>& offset : neighbors)
+				if (inside(x + offset.x(), y + offset.y(), z + offset.z()))
+					slabEdges[s]++;
+		}
+	},
+	1);
+
+	std::size_t numNodes = 0;
+	std::size_t numEdges = 0;
+	for (int s = 0; s < numSlabs; s++) {
+
+		numNodes += slabNodes[s];
+		numEdges += slabEdges[s];
+	}
+
+	// ListGraph is not thread-safe, add nodes and edges sequentially in a 
+	// single scan, with exactly reserved memory
+	Graph& graph = _data->graph;
+
+	graph.reserveNode(numNodes);
+	graph.reserveEdge(numEdges);
+
+	// preceding neighbors are at most one section back, so the node ids of the 
+	// current and the previous section are enough to find them
+	const std::size_t sectionSize = static_cast<std::size_t>(bb.width())*bb.height();
+	std::vector<int> nodeIds(2*sectionSize);
+
+	auto nodeId = [&](int x, int y, int z) -> int& {
+
+		return nodeIds[
+				((z - bb.min().z())%2)*sectionSize +
+				static_cast<std::size_t>(y - bb.min().y())*bb.width() +
+				(x - bb.min().x())];
+	};
+
+	for (int z = bb.min().z(); z < bb.max().z(); z++)
+	for (int y = bb.min().y(); y < bb.max().y(); y++)
+	for (int x = bb.min().x(); x < bb.max().x(); x++) {
+
+		if (volume(x, y, z) == 0)
+			continue;
+
+		Node node = graph.addNode();
+		_data->positions[node] = Position(x, y, z);
+		nodeId(x, y, z) = graph.id(node);
+
+		for (const util::point<int,3>& offset : neighbors) {
+
+			int nx = x + offset.x();
+			int ny = y + offset.y();
+			int nz = z + offset.z();
+
+			if (inside(nx, ny, nz))
+				graph.addEdge(graph.nodeFromId(nodeId(nx, ny, nz)), node);
+		}
+	}
 }
 
 #endif // IMAGEPROCESSING_GRAPH_VOLUME_H__
@@ -0,0 +1,380 @@
+#include "GraphVolumeFile.h"
+
+namespace {
+
+// all parts of a file are aligned to this many bytes
+const std::size_t Alignment = 8;
+
+std::size_t padding(std::size_t size) { return (Alignment - size%Alignment)%Alignment; }
+
+std::size_t aligned(std::size_t size) { return size + padding(size); }
+
+/**
+ * Reserve the aligned space for count values of the given size from the 
+ * remaining bytes of a record. Returns false, if they do not fit.
+ */
+bool take(std::uint64_t count, std::uint64_t size, std::uint64_t& remaining) {
+
+	// compare before multiplying, such that count*size does not overflow
+	if (count > remaining/size)
+		return false;
+
+	std::uint64_t bytes = aligned(count*size);
+	if (bytes > remaining)
+		return false;
+
+	remaining -= bytes;
+	return true;
+}
+
+} // anonymous namespace
+
+GraphVolumeWriter::GraphVolumeWriter(const std::string& filename) :
+	_filename(filename),
+	_out(filename.c_str(), std::ios::binary | std::ios::trunc),
+	_position(0) {
+
+	if (!_out)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"could not create " << filename);
+
+	GraphVolumeFile::Header header;
+	header.magic    = GraphVolumeFile::Magic;
+	header.version  = GraphVolumeFile::Version;
+	header.reserved = 0;
+
+	writeBytes(&header, sizeof(header));
+}
+
+GraphVolumeWriter::~GraphVolumeWriter() {
+
+	// errors can not be reported from here, call close() to see them
+	if (_out.is_open()) {
+
+		try {
+
+			close();
+
+		} catch (...) {}
+	}
+}
+
+void
+GraphVolumeWriter::write(std::uint64_t id, const GraphVolume& graphVolume) {
+
+	writeRecord(id, graphVolume, 0);
+}
+
+void
+GraphVolumeWriter::write(std::uint64_t id, const Skeleton& skeleton) {
+
+	writeRecord(id, skeleton, &skeleton.diameters());
+}
+
+void
+GraphVolumeWriter::close() {
+
+	if (!_out.is_open())
+		return;
+
+	GraphVolumeFile::Trailer trailer;
+	trailer.indexOffset = _position;
+	trailer.numEntries  = _index.size();
+	trailer.magic       = GraphVolumeFile::Magic;
+
+	writeBytes(_index.data(), sizeof(GraphVolumeFile::IndexEntry)*_index.size());
+	writeBytes(&trailer, sizeof(trailer));
+
+	_out.close();
+
+	if (!_out)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"could not write " << _filename);
+}
+
+void
+GraphVolumeWriter::writeRecord(
+		std::uint64_t id,
+		const GraphVolume& graphVolume,
+		const Skeleton::Diameters* diameters) {
+
+	typedef GraphVolume::Graph Graph;
+
+	if (!_out.is_open())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"can not write to " << _filename << " after it was closed");
+
+	if (!_ids.insert(id).second)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"a record with id " << id << " was already written to " << _filename);
+
+	const Graph& graph = graphVolume.graph();
+
+	GraphVolumeFile::IndexEntry entry;
+	entry.id     = id;
+	entry.offset = _position;
+	_index.push_back(entry);
+
+	GraphVolumeFile::RecordHeader header;
+	header.type         = (diameters ? GraphVolumeFile::SkeletonRecord : GraphVolumeFile::GraphVolumeRecord);
+	header.connectivity = (diameters ? 0 : graphVolume.getConnectivity());
+	header.numNodes     = lemon::countNodes(graph);
+	header.numEdges     = lemon::countEdges(graph);
+	for (int d = 0; d < 3; d++) {
+
+		header.resolution[d] = graphVolume.getResolution()[d];
+		header.offset[d]     = graphVolume.getOffset()[d];
+	}
+
+	writeBytes(&header, sizeof(header));
+
+	// nodes are stored in iteration order, remember the number of each node
+	// for the edges
+	std::vector<std::uint32_t> numbers(graph.maxNodeId() + 1);
+	std::vector<std::uint32_t> positions;
+	std::vector<float>         nodeDiameters;
+	positions.reserve(3*header.numNodes);
+	if (diameters)
+		nodeDiameters.reserve(header.numNodes);
+
+	std::uint32_t number = 0;
+	for (Graph::NodeIt node(graph); node != lemon::INVALID; ++node) {
+
+		const GraphVolume::Position& position = graphVolume.positions()[node];
+
+		numbers[graph.id(node)] = number++;
+		positions.push_back(position.x());
+		positions.push_back(position.y());
+		positions.push_back(position.z());
+
+		if (diameters)
+			nodeDiameters.push_back((*diameters)[node]);
+	}
+
+	std::vector<std::uint32_t> edges;
+	edges.reserve(2*header.numEdges);
+
+	for (Graph::EdgeIt edge(graph); edge != lemon::INVALID; ++edge) {
+
+		edges.push_back(numbers[graph.id(graph.u(edge))]);
+		edges.push_back(numbers[graph.id(graph.v(edge))]);
+	}
+
+	writeBytes(positions.data(), sizeof(std::uint32_t)*positions.size());
+	writeBytes(edges.data(), sizeof(std::uint32_t)*edges.size());
+	if (diameters)
+		writeBytes(nodeDiameters.data(), sizeof(float)*nodeDiameters.size());
+}
+
+void
+GraphVolumeWriter::writeBytes(const void* data, std::size_t size) {
+
+	static const char zeros[Alignment] = {};
+
+	_out.write(static_cast<const char*>(data), size);
+	_out.write(zeros, padding(size));
+	_position += aligned(size);
+
+	if (!_out)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"could not write " << _filename);
+}
+
+GraphVolumeReader::GraphVolumeReader(const std::string& filename) :
+	_file(filename) {
+
+	const std::size_t minSize = sizeof(GraphVolumeFile::Header) + sizeof(GraphVolumeFile::Trailer);
+
+	if (_file.size() < minSize)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				filename << " is too small to be a graph volume file");
+
+	const GraphVolumeFile::Header& header = *reinterpret_cast<const GraphVolumeFile::Header*>(_file.data());
+
+	if (header.magic != GraphVolumeFile::Magic)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				filename << " is not a graph volume file");
+
+	if (header.version != GraphVolumeFile::Version)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				filename << " has version " << header.version << ", but only version "
+				<< GraphVolumeFile::Version << " is supported");
+
+	const GraphVolumeFile::Trailer& trailer =
+			*reinterpret_cast<const GraphVolumeFile::Trailer*>(
+					_file.data() + _file.size() - sizeof(GraphVolumeFile::Trailer));
+
+	// the index fills the space between the records and the trailer
+	const std::uint64_t indexEnd = _file.size() - sizeof(GraphVolumeFile::Trailer);
+
+	if (trailer.magic != GraphVolumeFile::Magic ||
+	    trailer.indexOffset < sizeof(GraphVolumeFile::Header) ||
+	    trailer.indexOffset > indexEnd ||
+	    trailer.indexOffset%Alignment != 0 ||
+	    (indexEnd - trailer.indexOffset)%sizeof(GraphVolumeFile::IndexEntry) != 0 ||
+	    (indexEnd - trailer.indexOffset)/sizeof(GraphVolumeFile::IndexEntry) != trailer.numEntries)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				filename << " is incomplete, it might not have been closed after writing");
+
+	const GraphVolumeFile::IndexEntry* entries =
+			reinterpret_cast<const GraphVolumeFile::IndexEntry*>(_file.data() + trailer.indexOffset);
+
+	for (std::uint64_t i = 0; i < trailer.numEntries; i++)
+		if (!_index.emplace(entries[i].id, entries[i].offset).second)
+			UTIL_THROW_EXCEPTION(
+					FileAccessError,
+					filename << " contains several records with id " << entries[i].id);
+
+	_recordsEnd = trailer.indexOffset;
+}
+
+std::vector<std::uint64_t>
+GraphVolumeReader::ids() const {
+
+	std::vector<std::uint64_t> ids;
+	for (const auto& entry : _index)
+		ids.push_back(entry.first);
+
+	return ids;
+}
+
+bool
+GraphVolumeReader::isSkeleton(std::uint64_t id) const {
+
+	return recordHeader(id).type == GraphVolumeFile::SkeletonRecord;
+}
+
+GraphVolume
+GraphVolumeReader::readGraphVolume(std::uint64_t id) const {
+
+	const GraphVolumeFile::RecordHeader& header = recordHeader(id);
+
+	// skeletons do not store a connectivity, they have the default one
+	GraphVolume graphVolume(
+			header.type == GraphVolumeFile::GraphVolumeRecord ?
+			static_cast<Connectivity>(header.connectivity) :
+			Connectivity26);
+	readRecord(id, graphVolume, 0);
+
+	return graphVolume;
+}
+
+Skeleton
+GraphVolumeReader::readSkeleton(std::uint64_t id) const {
+
+	if (!isSkeleton(id))
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"record " << id << " in " << _file.filename() << " is not a skeleton");
+
+	Skeleton skeleton;
+	readRecord(id, skeleton, &skeleton.mutableDiameters());
+
+	return skeleton;
+}
+
+const GraphVolumeFile::RecordHeader&
+GraphVolumeReader::recordHeader(std::uint64_t id) const {
+
+	std::map<std::uint64_t, std::uint64_t>::const_iterator entry = _index.find(id);
+
+	if (entry == _index.end())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				_file.filename() << " does not contain a record with id " << id);
+
+	const std::uint64_t offset = entry->second;
+
+	if (offset < sizeof(GraphVolumeFile::Header) ||
+	    offset%Alignment != 0 ||
+	    offset > _recordsEnd ||
+	    _recordsEnd - offset < aligned(sizeof(GraphVolumeFile::RecordHeader)))
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"record " << id << " in " << _file.filename() << " is out of bounds");
+
+	const GraphVolumeFile::RecordHeader& header =
+			*reinterpret_cast<const GraphVolumeFile::RecordHeader*>(_file.data() + offset);
+
+	if (header.type != GraphVolumeFile::GraphVolumeRecord && header.type != GraphVolumeFile::SkeletonRecord)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"record " << id << " in " << _file.filename() << " has an invalid type " << header.type);
+
+	if (header.type == GraphVolumeFile::GraphVolumeRecord &&
+	    header.connectivity != Connectivity6 &&
+	    header.connectivity != Connectivity18 &&
+	    header.connectivity != Connectivity26)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"record " << id << " in " << _file.filename() << " has an invalid connectivity " << header.connectivity);
+
+	std::uint64_t remaining = _recordsEnd - offset - aligned(sizeof(header));
+
+	if (!take(header.numNodes, 3*sizeof(std::uint32_t), remaining) ||
+	    !take(header.numEdges, 2*sizeof(std::uint32_t), remaining) ||
+	    (header.type == GraphVolumeFile::SkeletonRecord && !take(header.numNodes, sizeof(float), remaining)))
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"record " << id << " in " << _file.filename() << " is truncated");
+
+	return header;
+}
+
+void
+GraphVolumeReader::readRecord(
+		std::uint64_t id,
+		GraphVolume& graphVolume,
+		Skeleton::Diameters* diameters) const {
+
+	typedef GraphVolume::Graph Graph;
+
+	const GraphVolumeFile::RecordHeader& header = recordHeader(id);
+
+	// the sizes were checked by recordHeader()
+	const char* begin = reinterpret_cast<const char*>(&header) + aligned(sizeof(header));
+
+	const std::uint32_t* positions     = reinterpret_cast<const std::uint32_t*>(begin);
+	const std::uint32_t* edges         = reinterpret_cast<const std::uint32_t*>(begin + aligned(3*sizeof(std::uint32_t)*header.numNodes));
+	const float*         nodeDiameters = reinterpret_cast<const float*>(
+			reinterpret_cast<const char*>(edges) + aligned(2*sizeof(std::uint32_t)*header.numEdges));
+
+	graphVolume.setResolution(header.resolution[0], header.resolution[1], header.resolution[2]);
+	graphVolume.setOffset(header.offset[0], header.offset[1], header.offset[2]);
+
+	Graph& graph = graphVolume.mutableGraph();
+	GraphVolume::Positions& nodePositions = graphVolume.mutablePositions();
+
+	graph.reserveNode(header.numNodes);
+	graph.reserveEdge(header.numEdges);
+
+	// nodes get consecutive ids in a new ListGraph, which are the node numbers
+	// in the file
+	for (std::uint64_t n = 0; n < header.numNodes; n++) {
+
+		Graph::Node node = graph.addNode();
+		nodePositions[node] = GraphVolume::Position(positions[3*n], positions[3*n + 1], positions[3*n + 2]);
+
+		if (diameters)
+			(*diameters)[node] = nodeDiameters[n];
+	}
+
+	for (std::uint64_t e = 0; e < header.numEdges; e++) {
+
+		if (edges[2*e] >= header.numNodes || edges[2*e + 1] >= header.numNodes)
+			UTIL_THROW_EXCEPTION(
+					FileAccessError,
+					"record " << id << " in " << _file.filename() << " contains an invalid edge");
+
+		graph.addEdge(graph.nodeFromId(edges[2*e]), graph.nodeFromId(edges[2*e + 1]));
+	}
+}
@@ -0,0 +1,184 @@
+#ifndef IMAGEPROCESSING_GRAPH_VOLUME_FILE_H__
+#define IMAGEPROCESSING_GRAPH_VOLUME_FILE_H__
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "GraphVolume.h"
+#include "MappedFile.h"
+#include "Skeleton.h"
+#include "exceptions.h"
+
+/**
+ * Binary files of GraphVolumes and Skeletons, each stored under an id.
+ *
+ * A file starts with a header (magic number and format version), followed by
+ * one record per graph volume or skeleton, and ends with an index of the
+ * records and a trailer pointing to the index. A record contains the
+ * resolution, offset, and connectivity (0 for skeletons, which do not have
+ * one), the positions of the nodes, the end points of the edges as node
+ * numbers, and for skeletons the diameters of the nodes. All values are
+ * stored in native byte order, 8-byte aligned, such that they can be read
+ * directly from a memory mapping.
+ */
+struct GraphVolumeFile {
+
+	static const std::uint64_t Magic   = 0x5348504152475049ULL; // "IPGRAPHS"
+	static const std::uint32_t Version = 1;
+
+	enum RecordType {
+
+		GraphVolumeRecord = 0,
+		SkeletonRecord    = 1
+	};
+
+	struct Header {
+
+		std::uint64_t magic;
+		std::uint32_t version;
+		std::uint32_t reserved;
+	};
+
+	struct RecordHeader {
+
+		std::uint32_t type;
+		std::uint32_t connectivity;
+		std::uint64_t numNodes;
+		std::uint64_t numEdges;
+		float         resolution[3];
+		float         offset[3];
+	};
+
+	struct IndexEntry {
+
+		std::uint64_t id;
+		std::uint64_t offset;
+	};
+
+	struct Trailer {
+
+		std::uint64_t indexOffset;
+		std::uint64_t numEntries;
+		std::uint64_t magic;
+	};
+};
+
+/**
+ * Writes GraphVolumes and Skeletons to a file, one after the other. The index
+ * is written when the writer is closed or destructed.
+ */
+class GraphVolumeWriter {
+
+public:
+
+	/**
+	 * Create a new file with the given name.
+	 */
+	explicit GraphVolumeWriter(const std::string& filename);
+
+	~GraphVolumeWriter();
+
+	GraphVolumeWriter(const GraphVolumeWriter& other) = delete;
+	GraphVolumeWriter& operator=(const GraphVolumeWriter& other) = delete;
+
+	/**
+	 * Append a graph volume or skeleton under the given id. Ids have to be
+	 * unique within a file, a UsageError is thrown otherwise.
+	 */
+	void write(std::uint64_t id, const GraphVolume& graphVolume);
+	void write(std::uint64_t id, const Skeleton& skeleton);
+
+	/**
+	 * Write the index and close the file.
+	 */
+	void close();
+
+private:
+
+	void writeRecord(
+			std::uint64_t id,
+			const GraphVolume& graphVolume,
+			const Skeleton::Diameters* diameters);
+
+	void writeBytes(const void* data, std::size_t size);
+
+	std::string   _filename;
+	std::ofstream _out;
+	std::uint64_t _position;
+
+	std::vector<GraphVolumeFile::IndexEntry> _index;
+	std::set<std::uint64_t>                  _ids;
+};
+
+/**
+ * Reads GraphVolumes and Skeletons from a memory-mapped file written by a
+ * GraphVolumeWriter. Only the index is read on opening, records are read on
+ * request directly from the mapping.
+ *
+ * Since a ListGraph owns its nodes and edges, they have to be added to it.
+ * Capacities are reserved exactly beforehand, such that a record is loaded
+ * without per-node allocations or intermediate buffers.
+ */
+class GraphVolumeReader {
+
+public:
+
+	/**
+	 * Open a file written by a GraphVolumeWriter. Throws a FileAccessError, if
+	 * the file is not a valid graph volume file.
+	 */
+	explicit GraphVolumeReader(const std::string& filename);
+
+	/**
+	 * The ids of all records in the file.
+	 */
+	std::vector<std::uint64_t> ids() const;
+
+	/**
+	 * Test whether the file contains a record with the given id.
+	 */
+	bool contains(std::uint64_t id) const { return _index.count(id) > 0; }
+
+	/**
+	 * Test whether the record with the given id is a skeleton.
+	 */
+	bool isSkeleton(std::uint64_t id) const;
+
+	/**
+	 * Read the graph volume with the given id. Skeletons can be read as graph
+	 * volumes, without their diameters.
+	 */
+	GraphVolume readGraphVolume(std::uint64_t id) const;
+
+	/**
+	 * Read the skeleton with the given id.
+	 */
+	Skeleton readSkeleton(std::uint64_t id) const;
+
+private:
+
+	/**
+	 * Get the header of a record, after checking that the record lies within
+	 * the file.
+	 */
+	const GraphVolumeFile::RecordHeader& recordHeader(std::uint64_t id) const;
+
+	void readRecord(
+			std::uint64_t id,
+			GraphVolume& graphVolume,
+			Skeleton::Diameters* diameters) const;
+
+	MappedFile _file;
+
+	// offset of each record in the file
+	std::map<std::uint64_t, std::uint64_t> _index;
+
+	// records are stored before this offset
+	std::uint64_t _recordsEnd;
+};
+
+#endif // IMAGEPROCESSING_GRAPH_VOLUME_FILE_H__
+
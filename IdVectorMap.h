@@ -0,0 +1,46 @@
+#ifndef IMAGEPROCESSING_ID_VECTOR_MAP_H__
+#define IMAGEPROCESSING_ID_VECTOR_MAP_H__
+
+#include <utility>
+#include <vector>
+#include <lemon/core.h>
+
+/**
+ * A LEMON reference map from graph items (nodes, edges, or arcs) to values, 
+ * stored in a vector indexed by the ids of the items. For static graphs, whose 
+ * items do not change after creation. Graph has to provide a static id(const 
+ * Key&).
+ */
+template <typename Graph, typename K, typename V>
+class IdVectorMap {
+
+public:
+
+	typedef K                                        Key;
+	typedef V                                        Value;
+	typedef typename std::vector<V>::reference       Reference;
+	typedef typename std::vector<V>::const_reference ConstReference;
+	typedef lemon::True                              ReferenceMapTag;
+
+	IdVectorMap() {}
+	IdVectorMap(std::size_t size, const V& value) : _values(size, value) {}
+	explicit IdVectorMap(std::vector<V>&& values) : _values(std::move(values)) {}
+
+	Reference      operator[](const K& key)       { return _values[Graph::id(key)]; }
+	ConstReference operator[](const K& key) const { return _values[Graph::id(key)]; }
+
+	void set(const K& key, const V& value) { _values[Graph::id(key)] = value; }
+
+	/**
+	 * Direct access to the values, ordered by id.
+	 */
+	std::vector<V>&       values()       { return _values; }
+	const std::vector<V>& values() const { return _values; }
+
+private:
+
+	std::vector<V> _values;
+};
+
+#endif // IMAGEPROCESSING_ID_VECTOR_MAP_H__
+
@@ -0,0 +1,147 @@
+#ifndef IMAGEPROCESSING_IMAGE_VIEW_H__
+#define IMAGEPROCESSING_IMAGE_VIEW_H__
+
+#include <memory>
+#include <vigra/multi_array.hxx>
+#include <util/exceptions.h>
+#include "DiscreteVolume.h"
+#include "Image.h"
+
+/**
+ * A 2D image that refers to pixel data stored elsewhere, through a (possibly 
+ * strided) vigra multi-array view, without copying it. Keeps the value type of 
+ * the data it refers to. Like Image, it is a discrete volume of depth one.
+ */
+template <typename ValueType>
+class ImageView : public DiscreteVolume {
+
+public:
+
+	typedef ValueType                           value_type;
+	typedef vigra::MultiArrayView<2, ValueType> data_type;
+
+	/**
+	 * Create an empty image view.
+	 */
+	ImageView() {}
+
+	/**
+	 * Create an image view on the given data.
+	 *
+	 * @param data
+	 *              A multi-array view on the pixel data.
+	 * @param owner
+	 *              Optional shared ownership of the memory the view refers to.
+	 */
+	explicit ImageView(
+			const data_type& data,
+			std::shared_ptr<void> owner = std::shared_ptr<void>()) :
+		_shape(data.shape()),
+		_stride(data.stride()),
+		_begin(data.data()),
+		_owner(owner) {}
+
+	/**
+	 * Create a view on a section of a volume, orthogonal to the given axis.  
+	 * The two axises of the image are the remaining axises of the volume in 
+	 * their original order, i.e., (x,y) for z-sections, (x,z) for y-sections, 
+	 * and (y,z) for x-sections. Resolution and offset of the image are set 
+	 * such that its first two coordinates are the ones of the section, and the 
+	 * third one is along the given axis.
+	 *
+	 * @param volume
+	 *              The discrete volume the data belongs to.
+	 * @param volumeData
+	 *              A multi-array view on the voxels of the volume.
+	 * @param axis
+	 *              The axis the section is orthogonal to (0, 1, or 2).
+	 * @param index
+	 *              The discrete coordinate of the section along axis.
+	 * @param owner
+	 *              Optional shared ownership of the memory the view refers to.
+	 */
+	template <typename Tag>
+	ImageView(
+			const DiscreteVolume& volume,
+			const vigra::MultiArrayView<3, ValueType, Tag>& volumeData,
+			int axis,
+			unsigned int index,
+			std::shared_ptr<void> owner = std::shared_ptr<void>()) :
+		_owner(owner) {
+
+		if (axis < 0 || axis > 2)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"invalid axis " << axis);
+
+		if (static_cast<vigra::MultiArrayIndex>(index) >= volumeData.shape(axis))
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"section " << index << " is out of range for axis " << axis);
+
+		int u = (axis == 0 ? 1 : 0);
+		int v = (axis == 2 ? 1 : 2);
+
+		_shape  = vigra::Shape2(volumeData.shape(u),  volumeData.shape(v));
+		_stride = vigra::Shape2(volumeData.stride(u), volumeData.stride(v));
+		_begin  = volumeData.data() + index*volumeData.stride(axis);
+
+		const util::point<float,3>& res = volume.getResolution();
+		const util::point<float,3>& min = volume.getBoundingBox().min();
+
+		setResolution(res[u], res[v], res[axis]);
+		setOffset(min[u], min[v], min[axis] + index*res[axis]);
+	}
+
+	/**
+	 * Pixel access.
+	 */
+	ValueType& operator()(unsigned int x, unsigned int y) const {
+
+		return _begin[x*_stride[0] + y*_stride[1]];
+	}
+
+	/**
+	 * Get a vigra multi-array view on the data of this image.
+	 */
+	data_type data() const { return data_type(_shape, _stride, _begin); }
+
+	/**
+	 * Get the (possibly empty) owner of the data.
+	 */
+	const std::shared_ptr<void>& owner() const { return _owner; }
+
+	unsigned int width()  const { return _shape[0]; }
+	unsigned int height() const { return _shape[1]; }
+
+	/**
+	 * Copy this view into a float Image with the same resolution and offset.
+	 */
+	Image toImage() const {
+
+		Image image;
+		image = data();
+		image.setResolution(getResolution());
+		image.setOffset(getOffset());
+
+		return image;
+	}
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override {
+
+		return util::box<unsigned int,3>(0, 0, 0, _shape[0], _shape[1], 1);
+	}
+
+private:
+
+	vigra::Shape2 _shape;
+	vigra::Shape2 _stride;
+	ValueType*    _begin = 0;
+
+	std::shared_ptr<void> _owner;
+};
+
+#endif // IMAGEPROCESSING_IMAGE_VIEW_H__
+
@@ -0,0 +1,15 @@
+#include "ImplicitGraphVolume.h"
+
+ImplicitGraphVolume::ImplicitGraphVolume() {}
+
+util::box<unsigned int,3>
+ImplicitGraphVolume::computeDiscreteBoundingBox() const {
+
+	util::box<unsigned int,3> bb;
+
+	// bounding box of discrete points
+	for (const Position& position : positions().values())
+		bb.fit(util::box<unsigned int,3>(position, position + Position(1, 1, 1)));
+
+	return bb;
+}
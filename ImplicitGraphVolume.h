@@ -0,0 +1,109 @@
+#ifndef IMAGEPROCESSING_IMPLICIT_GRAPH_VOLUME_H__
+#define IMAGEPROCESSING_IMPLICIT_GRAPH_VOLUME_H__
+
+#include <vector>
+#include "ExplicitVolume.h"
+#include "ImplicitGridGraph.h"
+
+/**
+ * A volume represented by nodes and edges on a 3D grid, like GraphVolume, but 
+ * without storing edges. Edges connect all neighboring nodes and are derived 
+ * from the node positions, see ImplicitGridGraph. The volume itself needs 
+ * about one position and one index entry per node, and can not be modified 
+ * after creation. Note that maps on edges are not smaller than for 
+ * GraphVolume: they have one entry per edge id, i.e., K entries per node for 
+ * K succeeding neighbor directions (13 for 26-connectivity). Skeletonize keeps 
+ * a double per edge, i.e., about 104 bytes per node, which dominates the 
+ * memory used for a skeletonization. Since ids are ints, the number of nodes 
+ * is limited to INT_MAX/(2*K), about 82 million for 26-connectivity.
+ *
+ * Provides the same interface as GraphVolume for reading, such that it can be 
+ * used in its place for Skeletonize.
+ */
+class ImplicitGraphVolume : public DiscreteVolume {
+
+public:
+
+	typedef ImplicitGridGraph        Graph;
+	typedef Graph::Node              Node;
+	typedef Graph::Edge              Edge;
+	typedef Graph::NodeIt            NodeIt;
+	typedef Graph::EdgeIt            EdgeIt;
+	typedef Graph::IncEdgeIt         IncEdgeIt;
+
+	typedef Graph::Position  Position;
+	typedef Graph::Positions Positions;
+
+	/**
+	 * Create an empty graph volume.
+	 */
+	ImplicitGraphVolume();
+
+	/**
+	 * Create a graph volume from an explicit volume. Nodes are numbered in 
+	 * scan order, neighboring voxels are connected according to the given 
+	 * connectivity.
+	 */
+	template <typename T>
+	explicit ImplicitGraphVolume(const ExplicitVolume<T>& volume, Connectivity connectivity = Connectivity26) { createFromVolume(volume, connectivity); }
+
+	/**
+	 * Create a graph volume from a view on an explicit volume.
+	 */
+	template <typename T>
+	explicit ImplicitGraphVolume(const ExplicitVolumeView<T>& volume, Connectivity connectivity = Connectivity26) { createFromVolume(volume, connectivity); }
+
+	const Graph& graph() const { return _graph; }
+
+	const Positions& positions() const { return _graph.positions(); }
+
+	/**
+	 * The connectivity this graph volume was created with.
+	 */
+	Connectivity getConnectivity() const { return _graph.getConnectivity(); }
+
+	/**
+	 * Size of neighborhood of a node.
+	 */
+	int numNeighbors() const { return _graph.getConnectivity(); }
+
+	/**
+	 * Size of neighborhood of a node for the default connectivity. Deprecated, 
+	 * use numNeighbors(), which takes the connectivity into account.
+	 */
+	static const int NumNeighbors = 26;
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override;
+
+private:
+
+	template <typename VolumeType>
+	void createFromVolume(const VolumeType& volume, Connectivity connectivity);
+
+	Graph _graph;
+};
+
+template <typename VolumeType>
+void
+ImplicitGraphVolume::createFromVolume(const VolumeType& volume, Connectivity connectivity) {
+
+	std::vector<Position> positions;
+
+	for (unsigned int z = 0; z < volume.depth();  z++)
+	for (unsigned int y = 0; y < volume.height(); y++)
+	for (unsigned int x = 0; x < volume.width();  x++)
+		if (volume(x, y, z) != 0)
+			positions.push_back(Position(x, y, z));
+
+	positions.shrink_to_fit();
+	_graph = Graph(std::move(positions), connectivity);
+
+	// our (0,0,0) would be at the same location as volume's (0,0,0)
+	setOffset(volume.getOffset());
+	setResolution(volume.getResolution());
+}
+
+#endif // IMAGEPROCESSING_IMPLICIT_GRAPH_VOLUME_H__
+
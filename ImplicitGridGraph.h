@@ -0,0 +1,449 @@
+#ifndef IMAGEPROCESSING_IMPLICIT_GRID_GRAPH_H__
+#define IMAGEPROCESSING_IMPLICIT_GRID_GRAPH_H__
+
+#include <limits>
+#include <utility>
+#include <vector>
+#include <lemon/core.h>
+#include <util/box.hpp>
+#include <util/exceptions.h>
+#include <util/point.hpp>
+#include "IdVectorMap.h"
+#include "PositionIndex.h"
+#include "connectivity.h"
+
+/**
+ * A static undirected graph of voxels on a 3D grid, where every pair of
+ * neighboring voxels (for a given connectivity) is connected. Only the
+ * positions of the nodes and an index from positions to nodes are stored, edges
+ * are derived from them on the fly.
+ *
+ * Edges have the id n*K + k, where n is the node with the smaller scan-order
+ * position, and k the direction to the other node out of the K directions to
+ * succeeding neighbors. Not all of these ids belong to edges, such that maps on
+ * edges and arcs have maxEdgeId() + 1 and maxArcId() + 1 entries, i.e., about
+ * K and 2*K entries per node. Only the graph itself is smaller than an
+ * explicit graph, maps on edges are not. Since ids are ints, the number of
+ * nodes is limited to INT_MAX/(2*K), about 82 million for 26-connectivity.
+ *
+ * Nodes are found by their positions with a PositionIndex.
+ *
+ * Models the LEMON undirected graph concept, such that it can be used with
+ * LEMON algorithms like lemon::Dijkstra.
+ */
+class ImplicitGridGraph {
+
+public:
+
+	typedef lemon::True UndirectedTag;
+	typedef lemon::True NodeNumTag;
+	typedef lemon::True EdgeNumTag;
+	typedef lemon::True ArcNumTag;
+
+	typedef util::point<unsigned int,3> Position;
+
+	class Node {
+
+		friend class ImplicitGridGraph;
+
+	public:
+
+		Node() {}
+		Node(lemon::Invalid) : _id(-1) {}
+
+		bool operator==(const Node& other) const { return _id == other._id; }
+		bool operator!=(const Node& other) const { return _id != other._id; }
+		bool operator<(const Node& other)  const { return _id <  other._id; }
+
+	protected:
+
+		explicit Node(int id) : _id(id) {}
+
+		int _id;
+	};
+
+	class Edge {
+
+		friend class ImplicitGridGraph;
+
+	public:
+
+		Edge() {}
+		Edge(lemon::Invalid) : _id(-1) {}
+
+		bool operator==(const Edge& other) const { return _id == other._id; }
+		bool operator!=(const Edge& other) const { return _id != other._id; }
+		bool operator<(const Edge& other)  const { return _id <  other._id; }
+
+	protected:
+
+		explicit Edge(int id) : _id(id) {}
+
+		int _id;
+	};
+
+	/**
+	 * The two directions of edge e are the arcs 2e (from u to v) and 2e+1
+	 * (from v to u).
+	 */
+	class Arc {
+
+		friend class ImplicitGridGraph;
+
+	public:
+
+		Arc() {}
+		Arc(lemon::Invalid) : _id(-1) {}
+
+		operator Edge() const { return (_id < 0 ? Edge(lemon::INVALID) : Edge(_id/2)); }
+
+		bool operator==(const Arc& other) const { return _id == other._id; }
+		bool operator!=(const Arc& other) const { return _id != other._id; }
+		bool operator<(const Arc& other)  const { return _id <  other._id; }
+
+	protected:
+
+		explicit Arc(int id) : _id(id) {}
+
+		int _id;
+	};
+
+	class NodeIt : public Node {
+
+	public:
+
+		NodeIt() {}
+		NodeIt(lemon::Invalid) : Node(lemon::INVALID) {}
+		explicit NodeIt(const ImplicitGridGraph& graph) : Node(graph.nodeNum() > 0 ? 0 : -1), _graph(&graph) {}
+		NodeIt(const ImplicitGridGraph& graph, const Node& node) : Node(node), _graph(&graph) {}
+
+		NodeIt& operator++() { _id = (_id + 1 < _graph->nodeNum() ? _id + 1 : -1); return *this; }
+
+	private:
+
+		const ImplicitGridGraph* _graph;
+	};
+
+	class EdgeIt : public Edge {
+
+	public:
+
+		EdgeIt() {}
+		EdgeIt(lemon::Invalid) : Edge(lemon::INVALID) {}
+		explicit EdgeIt(const ImplicitGridGraph& graph) : Edge(graph.nextEdge(-1)), _graph(&graph) {}
+		EdgeIt(const ImplicitGridGraph& graph, const Edge& edge) : Edge(edge), _graph(&graph) {}
+
+		EdgeIt& operator++() { _id = _graph->nextEdge(_id); return *this; }
+
+	private:
+
+		const ImplicitGridGraph* _graph;
+	};
+
+	class ArcIt : public Arc {
+
+	public:
+
+		ArcIt() {}
+		ArcIt(lemon::Invalid) : Arc(lemon::INVALID) {}
+		explicit ArcIt(const ImplicitGridGraph& graph) : Arc(toArc(graph.nextEdge(-1))), _graph(&graph) {}
+		ArcIt(const ImplicitGridGraph& graph, const Arc& arc) : Arc(arc), _graph(&graph) {}
+
+		ArcIt& operator++() { _id = (_id%2 == 0 ? _id + 1 : toArc(_graph->nextEdge(_id/2))); return *this; }
+
+	private:
+
+		static int toArc(int edge) { return (edge < 0 ? -1 : 2*edge); }
+
+		const ImplicitGridGraph* _graph;
+	};
+
+	/**
+	 * Iterates over the incident edges of a node, by probing all neighbor
+	 * directions. Base for the incidence iterators below.
+	 */
+	class IncidenceIt {
+
+	protected:
+
+		IncidenceIt() {}
+		IncidenceIt(const ImplicitGridGraph& graph, const Node& node) :
+			_graph(&graph),
+			_node(ImplicitGridGraph::id(node)),
+			_direction(-1) {}
+
+		/**
+		 * Advance to the next incident edge. Returns the arc from the node
+		 * along this edge, or -1 at the end.
+		 */
+		int next() {
+
+			const int k = _graph->_offsets.size();
+
+			while (++_direction < 2*k) {
+
+				if (_direction < k) {
+
+					// edge to a succeeding neighbor
+					int neighbor = _graph->neighbor(_node, _direction, 1);
+					if (neighbor >= 0)
+						return 2*(_node*k + _direction);
+
+				} else {
+
+					// edge from a preceding neighbor
+					int neighbor = _graph->neighbor(_node, _direction - k, -1);
+					if (neighbor >= 0)
+						return 2*(neighbor*k + _direction - k) + 1;
+				}
+			}
+
+			return -1;
+		}
+
+		const ImplicitGridGraph* _graph;
+		int _node;
+		int _direction;
+	};
+
+	class OutArcIt : public Arc, private IncidenceIt {
+
+	public:
+
+		OutArcIt() {}
+		OutArcIt(lemon::Invalid) : Arc(lemon::INVALID) {}
+		OutArcIt(const ImplicitGridGraph& graph, const Node& node) : IncidenceIt(graph, node) { _id = next(); }
+
+		OutArcIt& operator++() { _id = next(); return *this; }
+	};
+
+	class InArcIt : public Arc, private IncidenceIt {
+
+	public:
+
+		InArcIt() {}
+		InArcIt(lemon::Invalid) : Arc(lemon::INVALID) {}
+		InArcIt(const ImplicitGridGraph& graph, const Node& node) : IncidenceIt(graph, node) { _id = opposite(next()); }
+
+		InArcIt& operator++() { _id = opposite(next()); return *this; }
+
+	private:
+
+		static int opposite(int arc) { return (arc < 0 ? -1 : arc^1); }
+	};
+
+	class IncEdgeIt : public Edge, private IncidenceIt {
+
+	public:
+
+		IncEdgeIt() {}
+		IncEdgeIt(lemon::Invalid) : Edge(lemon::INVALID) {}
+		IncEdgeIt(const ImplicitGridGraph& graph, const Node& node) : IncidenceIt(graph, node) { _id = toEdge(next()); }
+
+		IncEdgeIt& operator++() { _id = toEdge(next()); return *this; }
+
+	private:
+
+		static int toEdge(int arc) { return (arc < 0 ? -1 : arc/2); }
+	};
+
+	template <typename V>
+	class NodeMap : public IdVectorMap<ImplicitGridGraph, Node, V> {
+
+	public:
+
+		NodeMap() {}
+		explicit NodeMap(const ImplicitGridGraph& graph, const V& value = V()) : IdVectorMap<ImplicitGridGraph, Node, V>(graph.nodeNum(), value) {}
+		NodeMap(const ImplicitGridGraph& graph, std::vector<V>&& values) : IdVectorMap<ImplicitGridGraph, Node, V>(std::move(values)) { (void)graph; }
+	};
+
+	template <typename V>
+	class EdgeMap : public IdVectorMap<ImplicitGridGraph, Edge, V> {
+
+	public:
+
+		EdgeMap() {}
+		explicit EdgeMap(const ImplicitGridGraph& graph, const V& value = V()) : IdVectorMap<ImplicitGridGraph, Edge, V>(graph.maxEdgeId() + 1, value) {}
+
+		// arcs are mapped to the values of their edges
+		using IdVectorMap<ImplicitGridGraph, Edge, V>::operator[];
+		typename IdVectorMap<ImplicitGridGraph, Edge, V>::Reference      operator[](const Arc& arc)       { return (*this)[Edge(arc)]; }
+		typename IdVectorMap<ImplicitGridGraph, Edge, V>::ConstReference operator[](const Arc& arc) const { return (*this)[Edge(arc)]; }
+	};
+
+	template <typename V>
+	class ArcMap : public IdVectorMap<ImplicitGridGraph, Arc, V> {
+
+	public:
+
+		ArcMap() {}
+		explicit ArcMap(const ImplicitGridGraph& graph, const V& value = V()) : IdVectorMap<ImplicitGridGraph, Arc, V>(graph.maxArcId() + 1, value) {}
+	};
+
+	typedef NodeMap<Position> Positions;
+
+	/**
+	 * Create an empty graph.
+	 */
+	ImplicitGridGraph() :
+		_connectivity(Connectivity26),
+		_offsets(succeedingOffsets(_connectivity)),
+		_numEdges(0) {}
+
+	/**
+	 * Create a graph with one node per given position, in the given order.
+	 * Positions have to be unique. Nodes are connected to their neighbors
+	 * according to the given connectivity.
+	 */
+	explicit ImplicitGridGraph(std::vector<Position>&& positions, Connectivity connectivity = Connectivity26) :
+		_connectivity(connectivity),
+		_offsets(succeedingOffsets(_connectivity)),
+		_positions(*this, std::move(positions)),
+		_numEdges(0) {
+
+		const std::vector<Position>& p = _positions.values();
+
+		// arc ids are 2*(n*K + k) + 1
+		if (p.size() > static_cast<std::size_t>(std::numeric_limits<int>::max())/(2*_offsets.size()))
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"too many nodes (" << p.size() << ") for an implicit grid graph, at most " <<
+					std::numeric_limits<int>::max()/(2*_offsets.size()) << " are supported");
+
+		util::box<unsigned int,3> boundingBox;
+		for (const Position& position : p)
+			boundingBox.fit(util::box<unsigned int,3>(position, position + Position(1, 1, 1)));
+
+		_index = PositionIndex(boundingBox, p.size());
+		for (std::size_t n = 0; n < p.size(); n++)
+			_index.insert(p[n], n);
+
+		for (int n = 0; n < nodeNum(); n++)
+			for (std::size_t k = 0; k < _offsets.size(); k++)
+				if (neighbor(n, k, 1) >= 0)
+					_numEdges++;
+	}
+
+	int nodeNum() const { return _positions.values().size(); }
+	int edgeNum() const { return _numEdges; }
+	int arcNum()  const { return 2*_numEdges; }
+
+	int maxNodeId() const { return nodeNum() - 1; }
+	int maxEdgeId() const { return nodeNum()*static_cast<int>(_offsets.size()) - 1; }
+	int maxArcId()  const { return 2*maxEdgeId() + 1; }
+
+	static int id(const Node& node) { return node._id; }
+	static int id(const Edge& edge) { return edge._id; }
+	static int id(const Arc& arc)   { return arc._id; }
+
+	static Node nodeFromId(int id) { return Node(id); }
+	static Edge edgeFromId(int id) { return Edge(id); }
+	static Arc  arcFromId(int id)  { return Arc(id); }
+
+	Node u(const Edge& edge) const { return Node(edge._id/_offsets.size()); }
+	Node v(const Edge& edge) const { return Node(neighbor(edge._id/_offsets.size(), edge._id%_offsets.size(), 1)); }
+
+	Node source(const Arc& arc) const { return (arc._id%2 == 0 ? u(arc) : v(arc)); }
+	Node target(const Arc& arc) const { return (arc._id%2 == 0 ? v(arc) : u(arc)); }
+
+	/**
+	 * True for the arc from u to v of its edge.
+	 */
+	static bool direction(const Arc& arc) { return arc._id%2 == 0; }
+	static Arc direct(const Edge& edge, bool forward) { return Arc(2*edge._id + (forward ? 0 : 1)); }
+	Arc direct(const Edge& edge, const Node& source) const { return direct(edge, u(edge) == source); }
+
+	static Arc oppositeArc(const Arc& arc) { return Arc(arc._id^1); }
+
+	Node oppositeNode(const Node& node, const Edge& edge) const {
+
+		Node first = u(edge);
+		return (first == node ? v(edge) : first);
+	}
+
+	/**
+	 * The positions of the nodes.
+	 */
+	const Positions& positions() const { return _positions; }
+
+	/**
+	 * Find the node at the given position. Returns lemon::INVALID, if there is
+	 * none.
+	 */
+	Node nodeAt(const Position& position) const {
+
+		return Node(_index.find(position));
+	}
+
+	/**
+	 * The connectivity of the nodes.
+	 */
+	Connectivity getConnectivity() const { return _connectivity; }
+
+	/**
+	 * True, if the position index is a dense array.
+	 */
+	bool hasDenseIndex() const { return _index.isDense(); }
+
+	/**
+	 * The number of bytes used by this graph.
+	 */
+	std::size_t memoryUsage() const {
+
+		return
+				sizeof(Position)*_positions.values().size() +
+				_index.memoryUsage();
+	}
+
+private:
+
+	static std::vector<util::point<int,3> > succeedingOffsets(Connectivity connectivity) {
+
+		std::vector<util::point<int,3> > offsets;
+		for (const util::point<int,3>& offset : getPrecedingNeighborOffsets(connectivity))
+			offsets.push_back(-offset);
+
+		return offsets;
+	}
+
+	/**
+	 * The id of the neighbor of node n in direction k (sign 1) or in the
+	 * opposite direction (sign -1), or -1.
+	 */
+	int neighbor(int n, int k, int sign) const {
+
+		const Position&           p = _positions.values()[n];
+		const util::point<int,3>& o = _offsets[k];
+
+		return _index.find(
+				static_cast<long>(p.x()) + sign*o.x(),
+				static_cast<long>(p.y()) + sign*o.y(),
+				static_cast<long>(p.z()) + sign*o.z());
+	}
+
+	/**
+	 * The id of the next edge after the given id, or -1.
+	 */
+	int nextEdge(int edge) const {
+
+		const int k = _offsets.size();
+		for (int e = edge + 1; e <= maxEdgeId(); e++)
+			if (neighbor(e/k, e%k, 1) >= 0)
+				return e;
+
+		return -1;
+	}
+
+	Connectivity _connectivity;
+
+	// offsets to the succeeding neighbors of a node
+	std::vector<util::point<int,3> > _offsets;
+
+	Positions _positions;
+
+	PositionIndex _index;
+
+	int _numEdges;
+};
+
+#endif // IMAGEPROCESSING_IMPLICIT_GRID_GRAPH_H__
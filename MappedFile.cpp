@@ -0,0 +1,62 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MappedFile.h"
+#include "exceptions.h"
+
+MappedFile::MappedFile(const std::string& filename) :
+	_filename(filename),
+	_data(0),
+	_size(0) {
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"could not open " << filename << ": " << std::strerror(errno));
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+
+		close(fd);
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"could not stat " << filename << ": " << std::strerror(errno));
+	}
+
+	_size = info.st_size;
+
+	// mmap does not accept empty mappings
+	if (_size == 0) {
+
+		close(fd);
+		return;
+	}
+
+	void* data = mmap(0, _size, PROT_READ, MAP_SHARED, fd, 0);
+
+	// the mapping stays valid after the file descriptor is closed
+	close(fd);
+
+	if (data == MAP_FAILED)
+		UTIL_THROW_EXCEPTION(
+				FileAccessError,
+				"could not map " << filename << ": " << std::strerror(errno));
+
+	_data = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile() {
+
+	if (_data)
+		munmap(const_cast<char*>(_data), _size);
+}
+
+bool
+MappedFile::exists(const std::string& filename) {
+
+	return access(filename.c_str(), R_OK) == 0;
+}
@@ -0,0 +1,50 @@
+#ifndef IMAGEPROCESSING_MAPPED_FILE_H__
+#define IMAGEPROCESSING_MAPPED_FILE_H__
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A read-only memory mapping of a file. The content of the file is paged in by 
+ * the operating system on first access.
+ */
+class MappedFile {
+
+public:
+
+	/**
+	 * Map the given file into memory.
+	 */
+	explicit MappedFile(const std::string& filename);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+	/**
+	 * Test whether a file with the given name exists and can be mapped.
+	 */
+	static bool exists(const std::string& filename);
+
+	/**
+	 * Get a pointer to the first byte of the mapped file.
+	 */
+	const char* data() const { return _data; }
+
+	/**
+	 * The size of the mapped file in bytes.
+	 */
+	std::size_t size() const { return _size; }
+
+	const std::string& filename() const { return _filename; }
+
+private:
+
+	std::string _filename;
+	const char* _data;
+	std::size_t _size;
+};
+
+#endif // IMAGEPROCESSING_MAPPED_FILE_H__
+
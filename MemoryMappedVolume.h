@@ -0,0 +1,175 @@
+#ifndef IMAGEPROCESSING_MEMORY_MAPPED_VOLUME_H__
+#define IMAGEPROCESSING_MEMORY_MAPPED_VOLUME_H__
+
+#include <memory>
+#include <string>
+#include <vigra/multi_array.hxx>
+#include "ExplicitVolume.h"
+#include "MappedFile.h"
+#include "exceptions.h"
+
+/**
+ * A read-only discrete volume backed by a memory-mapped raw file. Voxels are 
+ * only read from disk when they are accessed, which allows working on volumes 
+ * that do not fit into memory. Copies share the same mapping.
+ */
+template <typename ValueType>
+class MemoryMappedVolume : public DiscreteVolume {
+
+public:
+
+	typedef ValueType                           value_type;
+	typedef vigra::MultiArrayView<3, ValueType> data_type;
+
+	/**
+	 * Map a raw file as a volume of the given size. The file is expected to 
+	 * contain width*height*depth values of type ValueType in x-major order 
+	 * (x changes fastest), optionally preceded by a header of the given number 
+	 * of bytes.
+	 */
+	MemoryMappedVolume(
+			const std::string& filename,
+			unsigned int width,
+			unsigned int height,
+			unsigned int depth,
+			std::size_t headerSize = 0) :
+		_file(std::make_shared<MappedFile>(filename)),
+		_shape(width, height, depth) {
+
+		std::size_t required = headerSize + sizeof(ValueType)*width*height*depth;
+
+		if (_file->size() < required)
+			UTIL_THROW_EXCEPTION(
+					FileAccessError,
+					filename << " contains " << _file->size() << " bytes, but "
+					<< required << " bytes are needed for a volume of size "
+					<< width << "x" << height << "x" << depth);
+
+		// the mapping is read-only, we only hand out const references to it
+		_begin = reinterpret_cast<ValueType*>(const_cast<char*>(_file->data() + headerSize));
+	}
+
+	/**
+	 * Pixel access.
+	 */
+	const ValueType& operator[](vigra::Shape3 pos) const { return (*this)(pos[0], pos[1], pos[2]); }
+	const ValueType& operator[](util::point<unsigned int, 3> pos) const { return (*this)(pos.x(), pos.y(), pos.z()); }
+	const ValueType& operator()(unsigned int x, unsigned int y, unsigned int z) const {
+
+		return _begin[x + _shape[0]*(y + _shape[1]*static_cast<std::size_t>(z))];
+	}
+
+	/**
+	 * 2D z-slice access.
+	 */
+	Image slice(int z) const {
+
+		vigra::MultiArrayView<2, ValueType> slice = data().template bind<2>(z);
+
+		Image image;
+		image = slice;
+		image.setResolution(
+				getResolutionX(),
+				getResolutionY(),
+				getResolutionZ());
+		image.setOffset(
+						getBoundingBox().min().x(),
+						getBoundingBox().min().y(),
+						getBoundingBox().min().z() + z*getResolutionZ());
+
+		return image;
+	}
+
+	/**
+	 * Get a vigra multi-array view on the mapped data. The view must only be 
+	 * read from.
+	 */
+	data_type data() const { return data_type(_shape, _begin); }
+
+	unsigned int width()  const { return _shape[0]; }
+	unsigned int height() const { return _shape[1]; }
+	unsigned int depth()  const { return _shape[2]; }
+
+	/**
+	 * Copy a subvolume of this volume into memory. Only the pages of the 
+	 * requested subvolume will be read.
+	 *
+	 * @param boundingBox
+	 *              The bounding box of the requested subvolume. The target gets 
+	 *              resized to be at least that large, but might be larger to 
+	 *              fit all the voxels that are intersecting the requested 
+	 *              subvolume.
+	 * @param target
+	 *              An explicit volume to fill.
+	 */
+	void cut(const util::box<float, 3>& boundingBox, ExplicitVolume<ValueType>& target) const {
+
+		util::point<unsigned int, 3> begin, end;
+
+		if (!getDiscreteRegion(boundingBox, begin, end)) {
+
+			target = ExplicitVolume<ValueType>();
+			return;
+		}
+
+		target = ExplicitVolume<ValueType>(
+				end.x() - begin.x(),
+				end.y() - begin.y(),
+				end.z() - begin.z());
+		target.setResolution(getResolution());
+		target.setOffset(getOffset() + begin*getResolution());
+
+		typedef typename data_type::difference_type Shape;
+		target.data() = data().subarray(
+				Shape(begin.x(), begin.y(), begin.z()),
+				Shape(end.x(),   end.y(),   end.z()));
+	}
+
+	/**
+	 * Get a view on a subvolume of this volume, without reading any voxels.  
+	 * The view keeps the mapping alive, and is read-only.
+	 *
+	 * @param boundingBox
+	 *              The bounding box of the requested subvolume. The view might 
+	 *              be larger to fit all the voxels that are intersecting the 
+	 *              requested subvolume.
+	 */
+	ExplicitVolumeView<ValueType> view(const util::box<float, 3>& boundingBox) const {
+
+		util::point<unsigned int, 3> begin, end;
+
+		if (!getDiscreteRegion(boundingBox, begin, end))
+			return ExplicitVolumeView<ValueType>();
+
+		typedef typename data_type::difference_type Shape;
+		ExplicitVolumeView<ValueType> view(
+				data().subarray(
+						Shape(begin.x(), begin.y(), begin.z()),
+						Shape(end.x(),   end.y(),   end.z())),
+				_file,
+				true);
+		view.setResolution(getResolution());
+		view.setOffset(getOffset() + begin*getResolution());
+
+		return view;
+	}
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override {
+
+		return util::box<unsigned int,3>(0, 0, 0, _shape[0], _shape[1], _shape[2]);
+	}
+
+private:
+
+	std::shared_ptr<MappedFile> _file;
+
+	vigra::Shape3 _shape;
+
+	// the first voxel in the mapped file
+	ValueType* _begin;
+};
+
+#endif // IMAGEPROCESSING_MEMORY_MAPPED_VOLUME_H__
+
@@ -0,0 +1,123 @@
+#ifndef IMAGEPROCESSING_POSITION_INDEX_H__
+#define IMAGEPROCESSING_POSITION_INDEX_H__
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include <util/box.hpp>
+#include <util/exceptions.h>
+#include <util/point.hpp>
+
+/**
+ * A map from discrete 3D positions to non-negative ints, e.g., node ids, with
+ * constant time lookup. The index is a dense array over a bounding box, if the
+ * entries fill at least one eighth of it, and a hash map otherwise. Both are
+ * keyed by the scan-order index of a position within the bounding box, which
+ * is unique as long as the number of voxels in the bounding box fits into 64
+ * bits.
+ */
+class PositionIndex {
+
+public:
+
+	typedef util::point<unsigned int,3> Position;
+
+	/**
+	 * Create an empty index.
+	 */
+	PositionIndex() :
+		_dense(true) {}
+
+	/**
+	 * Create an empty index for the given number of entries within the given
+	 * bounding box. Throws a UsageError, if the bounding box has more than
+	 * 2^64 voxels.
+	 */
+	PositionIndex(const util::box<unsigned int,3>& boundingBox, std::size_t numEntries) :
+		_boundingBox(boundingBox) {
+
+		const std::uint64_t max     = std::numeric_limits<std::uint64_t>::max();
+		const std::uint64_t section = static_cast<std::uint64_t>(_boundingBox.width())*_boundingBox.height();
+
+		if (_boundingBox.depth() > 0 && section > max/_boundingBox.depth())
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"a bounding box of size " << _boundingBox.width() << "x" << _boundingBox.height() << "x" <<
+					_boundingBox.depth() << " is too large for a position index");
+
+		const std::uint64_t size = section*_boundingBox.depth();
+		_dense = (size <= 8*static_cast<std::uint64_t>(numEntries));
+
+		if (_dense)
+			_denseIndex.assign(size, -1);
+		else
+			_hashIndex.reserve(numEntries);
+	}
+
+	/**
+	 * Map a position within the bounding box to the given value.
+	 */
+	void insert(const Position& position, int value) {
+
+		if (_dense)
+			_denseIndex[index(position.x(), position.y(), position.z())] = value;
+		else
+			_hashIndex[index(position.x(), position.y(), position.z())] = value;
+	}
+
+	/**
+	 * Get the value of the given position, or -1 if there is none.
+	 */
+	int find(long x, long y, long z) const {
+
+		if (x < _boundingBox.min().x() || x >= _boundingBox.max().x() ||
+		    y < _boundingBox.min().y() || y >= _boundingBox.max().y() ||
+		    z < _boundingBox.min().z() || z >= _boundingBox.max().z())
+			return -1;
+
+		if (_dense)
+			return _denseIndex[index(x, y, z)];
+
+		std::unordered_map<std::uint64_t, int>::const_iterator i = _hashIndex.find(index(x, y, z));
+		return (i == _hashIndex.end() ? -1 : i->second);
+	}
+
+	int find(const Position& position) const { return find(position.x(), position.y(), position.z()); }
+
+	/**
+	 * True, if the index is a dense array.
+	 */
+	bool isDense() const { return _dense; }
+
+	/**
+	 * The number of bytes used by this index.
+	 */
+	std::size_t memoryUsage() const {
+
+		return
+				sizeof(int)*_denseIndex.size() +
+				(sizeof(std::uint64_t) + sizeof(int) + 2*sizeof(void*))*_hashIndex.size();
+	}
+
+private:
+
+	// the scan-order index of a position within the bounding box
+	std::uint64_t index(unsigned int x, unsigned int y, unsigned int z) const {
+
+		return
+				(x - _boundingBox.min().x()) +
+				static_cast<std::uint64_t>(_boundingBox.width())*(
+						(y - _boundingBox.min().y()) +
+						static_cast<std::uint64_t>(_boundingBox.height())*(z - _boundingBox.min().z()));
+	}
+
+	util::box<unsigned int,3> _boundingBox;
+
+	bool _dense;
+	std::vector<int>                        _denseIndex;
+	std::unordered_map<std::uint64_t, int>  _hashIndex;
+};
+
+#endif // IMAGEPROCESSING_POSITION_INDEX_H__
+
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <util/exceptions.h>
+#include "RunLengthVolume.h"
+
+RunLengthVolume::RunLengthVolume() :
+	_width(0),
+	_height(0),
+	_depth(0),
+	_rowBegins(1, 0) {}
+
+RunLengthVolume::RunLengthVolume(
+		unsigned int width,
+		unsigned int height,
+		unsigned int depth) :
+	_width(width),
+	_height(height),
+	_depth(depth),
+	_rowBegins(static_cast<std::size_t>(height)*depth + 1, 0) {}
+
+bool
+RunLengthVolume::operator()(unsigned int x, unsigned int y, unsigned int z) const {
+
+	// find the first run that ends after x
+	const_iterator run = std::upper_bound(
+			begin(y, z),
+			end(y, z),
+			x,
+			[](unsigned int x, const Run& run) { return x < run.end; });
+
+	return run != end(y, z) && run->begin <= x;
+}
+
+std::size_t
+RunLengthVolume::numVoxels() const {
+
+	std::size_t numVoxels = 0;
+	for (const Run& run : _runs)
+		numVoxels += run.end - run.begin;
+
+	return numVoxels;
+}
+
+ExplicitVolume<unsigned char>
+RunLengthVolume::decompress() const {
+
+	ExplicitVolume<unsigned char> volume(_width, _height, _depth, 0);
+	volume.setResolution(getResolution());
+	volume.setOffset(getOffset());
+
+	parallelFor(0, _depth, [&](std::size_t beginZ, std::size_t endZ) {
+
+		for (unsigned int z = beginZ; z < endZ; z++)
+		for (unsigned int y = 0; y < _height; y++)
+		for (const_iterator run = begin(y, z); run != end(y, z); run++)
+		for (unsigned int x = run->begin; x < run->end; x++)
+			volume(x, y, z) = 1;
+	});
+
+	return volume;
+}
+
+RunLengthVolume
+RunLengthVolume::operator|(const RunLengthVolume& other) const {
+
+	return combine(other, [](bool a, bool b) { return a || b; });
+}
+
+RunLengthVolume
+RunLengthVolume::operator&(const RunLengthVolume& other) const {
+
+	return combine(other, [](bool a, bool b) { return a && b; });
+}
+
+RunLengthVolume
+RunLengthVolume::operator-(const RunLengthVolume& other) const {
+
+	return combine(other, [](bool a, bool b) { return a && !b; });
+}
+
+RunLengthVolume
+RunLengthVolume::operator^(const RunLengthVolume& other) const {
+
+	return combine(other, [](bool a, bool b) { return a != b; });
+}
+
+template <typename Op>
+RunLengthVolume
+RunLengthVolume::combine(const RunLengthVolume& other, Op op) const {
+
+	if (_width != other._width || _height != other._height || _depth != other._depth)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"run-length volumes of different sizes can not be combined");
+
+	if (getResolution() != other.getResolution() || getOffset() != other.getOffset())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"run-length volumes with different resolutions or offsets can not be combined");
+
+	RunLengthVolume result(_width, _height, _depth);
+	result.setResolution(getResolution());
+	result.setOffset(getOffset());
+
+	const std::size_t numRows = static_cast<std::size_t>(_height)*_depth;
+
+	for (std::size_t r = 0; r < numRows; r++) {
+
+		const_iterator a    = _runs.begin() + _rowBegins[r];
+		const_iterator aEnd = _runs.begin() + _rowBegins[r + 1];
+		const_iterator b    = other._runs.begin() + other._rowBegins[r];
+		const_iterator bEnd = other._runs.begin() + other._rowBegins[r + 1];
+
+		// sweep over the run boundaries of both rows
+		bool         inside = false;
+		unsigned int begin  = 0;
+		unsigned int x      = 0;
+
+		while (true) {
+
+			while (a != aEnd && a->end <= x) a++;
+			while (b != bEnd && b->end <= x) b++;
+
+			bool now = op(
+					a != aEnd && a->begin <= x,
+					b != bEnd && b->begin <= x);
+
+			if (now && !inside)
+				begin = x;
+
+			if (!now && inside) {
+
+				Run run;
+				run.begin = begin;
+				run.end   = x;
+				result._runs.push_back(run);
+			}
+
+			inside = now;
+
+			if (a == aEnd && b == bEnd)
+				break;
+
+			// the next position where the state of a or b changes
+			unsigned int next = _width;
+			if (a != aEnd) next = std::min(next, (x < a->begin ? a->begin : a->end));
+			if (b != bEnd) next = std::min(next, (x < b->begin ? b->begin : b->end));
+			x = next;
+		}
+
+		result._rowBegins[r + 1] = result._runs.size();
+	}
+
+	return result;
+}
+
+util::box<unsigned int,3>
+RunLengthVolume::computeDiscreteBoundingBox() const {
+
+	return util::box<unsigned int,3>(0, 0, 0, _width, _height, _depth);
+}
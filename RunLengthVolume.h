@@ -0,0 +1,171 @@
+#ifndef IMAGEPROCESSING_RUN_LENGTH_VOLUME_H__
+#define IMAGEPROCESSING_RUN_LENGTH_VOLUME_H__
+
+#include <vector>
+#include "ExplicitVolume.h"
+#include "parallel.h"
+
+/**
+ * A binary volume, represented by runs of inside voxels along x for each row 
+ * (y,z). Suitable for sparse masks like long and thin objects, where it needs 
+ * much less memory than a dense volume. Voxel counts and boolean operations 
+ * are computed directly on the runs.
+ */
+class RunLengthVolume : public DiscreteVolume {
+
+public:
+
+	/**
+	 * A run [begin, end) of inside voxels along x.
+	 */
+	struct Run {
+
+		unsigned int begin;
+		unsigned int end;
+	};
+
+	typedef std::vector<Run>::const_iterator const_iterator;
+
+	/**
+	 * Create an empty run-length volume.
+	 */
+	RunLengthVolume();
+
+	/**
+	 * Create a run-length volume of the given size without inside voxels.
+	 */
+	RunLengthVolume(
+			unsigned int width,
+			unsigned int height,
+			unsigned int depth);
+
+	/**
+	 * Create a run-length volume from the non-zero voxels of an explicit 
+	 * volume. Rows are encoded in parallel.
+	 */
+	template <typename T>
+	explicit RunLengthVolume(const ExplicitVolume<T>& volume);
+
+	unsigned int width()  const { return _width; }
+	unsigned int height() const { return _height; }
+	unsigned int depth()  const { return _depth; }
+
+	/**
+	 * Test whether a voxel is inside. Takes logarithmic time in the number of 
+	 * runs of the row.
+	 */
+	bool operator()(unsigned int x, unsigned int y, unsigned int z) const;
+
+	/**
+	 * Iterate over the runs of a row, ordered by x.
+	 */
+	const_iterator begin(unsigned int y, unsigned int z) const { return _runs.begin() + _rowBegins[row(y, z)]; }
+	const_iterator end(unsigned int y, unsigned int z)   const { return _runs.begin() + _rowBegins[row(y, z) + 1]; }
+
+	/**
+	 * The total number of runs.
+	 */
+	std::size_t numRuns() const { return _runs.size(); }
+
+	/**
+	 * The number of inside voxels.
+	 */
+	std::size_t numVoxels() const;
+
+	/**
+	 * Create an explicit volume with inside voxels set to 1.
+	 */
+	ExplicitVolume<unsigned char> decompress() const;
+
+	/**
+	 * Boolean operations between run-length volumes of the same size, 
+	 * resolution, and offset.
+	 */
+	RunLengthVolume operator|(const RunLengthVolume& other) const;
+	RunLengthVolume operator&(const RunLengthVolume& other) const;
+	RunLengthVolume operator-(const RunLengthVolume& other) const;
+	RunLengthVolume operator^(const RunLengthVolume& other) const;
+
+protected:
+
+	util::box<unsigned int,3> computeDiscreteBoundingBox() const override;
+
+private:
+
+	std::size_t row(unsigned int y, unsigned int z) const { return y + static_cast<std::size_t>(_height)*z; }
+
+	/**
+	 * Combine two run-length volumes row by row. op(a, b) decides whether a 
+	 * voxel is inside the result, given whether it is inside this and the 
+	 * other volume.
+	 */
+	template <typename Op>
+	RunLengthVolume combine(const RunLengthVolume& other, Op op) const;
+
+	unsigned int _width;
+	unsigned int _height;
+	unsigned int _depth;
+
+	// for each row, the position of its first run in _runs, followed by the 
+	// total number of runs
+	std::vector<std::size_t> _rowBegins;
+
+	std::vector<Run> _runs;
+};
+
+template <typename T>
+RunLengthVolume::RunLengthVolume(const ExplicitVolume<T>& volume) :
+	DiscreteVolume(volume),
+	_width(volume.width()),
+	_height(volume.height()),
+	_depth(volume.depth()),
+	_rowBegins(static_cast<std::size_t>(_height)*_depth + 1, 0) {
+
+	const std::size_t numRows = static_cast<std::size_t>(_height)*_depth;
+	const std::size_t numSlabs = std::max<std::size_t>(std::min(numParallelThreads(), numRows), 1);
+
+	std::vector<std::vector<Run> > slabRuns(numSlabs);
+
+	// encode slabs of rows in parallel, remember the number of runs per row
+	parallelFor(0, numSlabs, [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (std::size_t s = beginSlab; s < endSlab; s++)
+		for (std::size_t r = s*numRows/numSlabs; r < (s + 1)*numRows/numSlabs; r++) {
+
+			unsigned int y = r%_height;
+			unsigned int z = r/_height;
+
+			std::size_t numRuns = slabRuns[s].size();
+
+			for (unsigned int x = 0; x < _width;) {
+
+				if (volume(x, y, z) == 0) {
+
+					x++;
+					continue;
+				}
+
+				Run run;
+				run.begin = x;
+				while (x < _width && volume(x, y, z) != 0)
+					x++;
+				run.end = x;
+
+				slabRuns[s].push_back(run);
+			}
+
+			_rowBegins[r + 1] = slabRuns[s].size() - numRuns;
+		}
+	},
+	1);
+
+	for (std::size_t r = 0; r < numRows; r++)
+		_rowBegins[r + 1] += _rowBegins[r];
+
+	_runs.reserve(_rowBegins[numRows]);
+	for (const std::vector<Run>& runs : slabRuns)
+		_runs.insert(_runs.end(), runs.begin(), runs.end());
+}
+
+#endif // IMAGEPROCESSING_RUN_LENGTH_VOLUME_H__
+
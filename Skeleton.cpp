@@ -1,33 +1,30 @@
 #include <util/assert.h>
 #include "Skeleton.h"
 
-Skeleton::Skeleton() {}
+Skeleton::Skeleton() :
+	GraphVolume(std::make_shared<Data>()) {}
 
-Skeleton::Skeleton(const Skeleton& other) :
-	GraphVolume(other) {
-	copy(other);
-}
+std::unique_ptr<GraphVolume::Data>
+Skeleton::Data::clone() const {
 
-Skeleton&
-Skeleton::operator=(const Skeleton& other) {
-	GraphVolume::operator=(other);
-	copy(other);
-	return *this;
-}
+	std::unique_ptr<Data> data(new Data);
+	copyTo(*data);
 
-void
-Skeleton::copy(const Skeleton& other) {
-	_currentSegmentPath = other._currentSegmentPath;
-	_prevNode = other._prevNode;
-	for (NodeIt n(graph()); n != lemon::INVALID; ++n)
-		(*_diameters)[n] = other.diameters()[n];
+	// node ids are preserved, such that the segment state can be copied as is
+	for (NodeIt node(graph); node != lemon::INVALID; ++node)
+		data->diameters[node] = diameters[node];
+
+	data->currentSegmentPath = currentSegmentPath;
+	data->prevNode           = prevNode;
+
+	return std::move(data);
 }
 
 Skeleton::Node
 Skeleton::openSegment(Position pos, float diameter) {
 
 	Node node = extendSegment(pos, diameter);
-	_currentSegmentPath.push(node);
+	skeletonData().currentSegmentPath.push(node);
 
 	return node;
 }
@@ -35,13 +32,15 @@ Skeleton::openSegment(Position pos, float diameter) {
 Skeleton::Node
 Skeleton::extendSegment(Position pos, float diameter) {
 
-	Node node = graph().addNode();
-	positions()[node] = pos;
-	diameters()[node] = diameter;
+	Data& data = skeletonData();
+
+	Node node = data.graph.addNode();
+	data.positions[node] = pos;
+	data.diameters[node] = diameter;
 
-	if (_prevNode != lemon::INVALID)
-		graph().addEdge(_prevNode, node);
-	_prevNode = node;
+	if (data.prevNode != lemon::INVALID)
+		data.graph.addEdge(data.prevNode, node);
+	data.prevNode = node;
 
 	return node;
 }
@@ -49,16 +48,18 @@ Skeleton::extendSegment(Position pos, float diameter) {
 void
 Skeleton::closeSegment() {
 
-	if (_currentSegmentPath.size() == 0)
+	Data& data = skeletonData();
+
+	if (data.currentSegmentPath.size() == 0)
 		UTIL_THROW_EXCEPTION(
 				UsageError,
 				"closeSegment() called without prior call to openSegment()");
 
-	_currentSegmentPath.pop();
+	data.currentSegmentPath.pop();
 
-	if (_currentSegmentPath.size() > 0)
-		_prevNode = _currentSegmentPath.top();
+	if (data.currentSegmentPath.size() > 0)
+		data.prevNode = data.currentSegmentPath.top();
 	else
-		_prevNode = Node(lemon::INVALID);
+		data.prevNode = Node(lemon::INVALID);
 }
 
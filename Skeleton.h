@@ -8,7 +8,8 @@
 #include "GraphVolume.h"
 
 /**
- * Represents a skeleton as a graph of terminal nodes and branch points.
+ * Represents a skeleton as a graph of terminal nodes and branch points. Like 
+ * GraphVolume, copies share their data until one of them is modified.
  */
 class Skeleton : public GraphVolume {
 
@@ -35,14 +36,14 @@ public:
 	Skeleton(Skeleton&& other) = default;
 
 	/**
-	 * Copy constructor.
+	 * Copy constructor. Shares the graph and node maps with other.
 	 */
-	Skeleton(const Skeleton& other);
+	Skeleton(const Skeleton& other) = default;
 
 	/**
-	 * Assignment operator.
+	 * Assignment operator. Shares the graph and node maps with other.
 	 */
-	Skeleton& operator=(const Skeleton& other);
+	Skeleton& operator=(const Skeleton& other) = default;
 
 	/**
 	 * Start a new segment (a chain of nodes) in the skeleton at the given 
@@ -64,19 +65,42 @@ public:
 	/**
 	 * Get a node property map with the diameters of each skeleton node.
 	 */
-	Diameters& diameters() { return *_diameters; }
-	const Diameters& diameters() const { return *_diameters; }
+	const Diameters& diameters() const { return skeletonData().diameters; }
+
+	/**
+	 * Get the diameters for modification. Makes a deep copy first, if they are 
+	 * shared with other skeletons.
+	 */
+	Diameters& mutableDiameters() { return skeletonData().diameters; }
+
+	/**
+	 * Deprecated, use mutableDiameters(), or the const version for reading. 
+	 * Makes a deep copy of shared data, even if only used for reading.
+	 */
+	Diameters& diameters() { return mutableDiameters(); }
 
 private:
 
-	void copy(const Skeleton& other);
+	/**
+	 * The data of a graph volume, extended by the diameters and the state of 
+	 * the segment currently being built.
+	 */
+	struct Data : public GraphVolume::Data {
+
+		Data() : diameters(graph) {}
+
+		std::unique_ptr<GraphVolume::Data> clone() const override;
+
+		Diameters diameters;
 
-	// list of previous segment end nodes
-	std::stack<Node> _currentSegmentPath;
-	// previously added node
-	Node             _prevNode = lemon::INVALID;
+		// list of previous segment end nodes
+		std::stack<Node> currentSegmentPath;
+		// previously added node
+		Node             prevNode = lemon::INVALID;
+	};
 
-	std::unique_ptr<Diameters> _diameters{new Diameters(graph())};
+	Data& skeletonData() { return static_cast<Data&>(data()); }
+	const Data& skeletonData() const { return static_cast<const Data&>(data()); }
 };
 
 #endif // IMAGEPROCESSING_TUBES_SKELETON_H__
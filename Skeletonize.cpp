@@ -44,14 +44,42 @@ util::ProgramOption optionSkeletonExplanationWeight(
 
 logger::LogChannel skeletonizelog("skeletonizelog", "[Skeletonize] ");
 
-Skeletonize::Skeletonize(const GraphVolume& graphVolume) :
+namespace {
+
+// Compact and implicit graph volumes do not share their graphs.
+template <typename GraphVolumeType>
+std::unique_ptr<GraphVolumeType>
+unsharedCopy(const GraphVolumeType&) {
+
+	return std::unique_ptr<GraphVolumeType>();
+}
+
+// Copies of a GraphVolume share their graph, attaching maps to it from 
+// different threads is not safe.
+std::unique_ptr<GraphVolume>
+unsharedCopy(const GraphVolume& graphVolume) {
+
+	if (!graphVolume.isShared())
+		return std::unique_ptr<GraphVolume>();
+
+	std::unique_ptr<GraphVolume> copy(new GraphVolume(graphVolume));
+	copy->detach();
+
+	return copy;
+}
+
+} // anonymous namespace
+
+template <typename GraphVolumeType>
+BasicSkeletonize<GraphVolumeType>::BasicSkeletonize(const GraphVolumeType& graphVolume) :
 	_boundaryDistance(
 			vigra::Shape3(
 					graphVolume.getDiscreteBoundingBox().width()  + 2,
 					graphVolume.getDiscreteBoundingBox().height() + 2,
 					graphVolume.getDiscreteBoundingBox().depth()  + 2
 			)),
-	_graphVolume(graphVolume),
+	_unsharedGraphVolume(unsharedCopy(graphVolume)),
+	_graphVolume(_unsharedGraphVolume ? *_unsharedGraphVolume : graphVolume),
 	_distanceMap(_graphVolume.graph()),
 	_dijkstra(_graphVolume.graph(), _distanceMap),
 	_nodeLabels(_graphVolume.graph(), Inside)
@@ -66,22 +94,25 @@ Skeletonize::Skeletonize(const GraphVolume& graphVolume) :
 	#endif
 	}
 
-Skeletonize::Skeletonize(const GraphVolume& graphVolume, Parameters user_parameters) :
+template <typename GraphVolumeType>
+BasicSkeletonize<GraphVolumeType>::BasicSkeletonize(const GraphVolumeType& graphVolume, Parameters user_parameters) :
  	_boundaryDistance(
 			vigra::Shape3(
  					graphVolume.getDiscreteBoundingBox().width()  + 2,
  					graphVolume.getDiscreteBoundingBox().height() + 2,
  					graphVolume.getDiscreteBoundingBox().depth()  + 2
  			)),
-	_graphVolume(graphVolume),
+	_unsharedGraphVolume(unsharedCopy(graphVolume)),
+	_graphVolume(_unsharedGraphVolume ? *_unsharedGraphVolume : graphVolume),
 	_distanceMap(_graphVolume.graph()),
 	_dijkstra(_graphVolume.graph(), _distanceMap),
 	_nodeLabels(_graphVolume.graph(), Inside),
 	_parameters(user_parameters) {}
 
 
+template <typename GraphVolumeType>
 Skeleton
-Skeletonize::getSkeleton() {
+BasicSkeletonize<GraphVolumeType>::getSkeleton() {
 
 	UTIL_TIME_METHOD;
 
@@ -97,16 +128,17 @@ Skeletonize::getSkeleton() {
 	return parseVolumeSkeleton();
 }
 
+template <typename GraphVolumeType>
 void
-Skeletonize::findBoundaryNodes() {
+BasicSkeletonize<GraphVolumeType>::findBoundaryNodes() {
 
-	for (GraphVolume::NodeIt node(_graphVolume.graph()); node != lemon::INVALID; ++node) {
+	for (NodeIt node(_graphVolume.graph()); node != lemon::INVALID; ++node) {
 
 		int numNeighbors = 0;
-		for (GraphVolume::IncEdgeIt e(_graphVolume.graph(), node); e != lemon::INVALID; ++e)
+		for (IncEdgeIt e(_graphVolume.graph(), node); e != lemon::INVALID; ++e)
 			numNeighbors++;
 
-		if (numNeighbors != GraphVolume::NumNeighbors) {
+		if (numNeighbors != _graphVolume.numNeighbors()) {
 
 			_boundary.push_back(node);
 			_nodeLabels[node] = Boundary;
@@ -114,8 +146,9 @@ Skeletonize::findBoundaryNodes() {
 	}
 }
 
+template <typename GraphVolumeType>
 void
-Skeletonize::initializeEdgeMap() {
+BasicSkeletonize<GraphVolumeType>::initializeEdgeMap() {
 
 	// the pitch is the number of units per voxel dimension
 	float pitch[3];
@@ -124,7 +157,7 @@ Skeletonize::initializeEdgeMap() {
 	pitch[2] = _graphVolume.getResolutionZ();
 
 	_boundaryDistance = 0;
-	for (GraphVolume::NodeIt n(_graphVolume.graph()); n != lemon::INVALID; ++n)
+	for (NodeIt n(_graphVolume.graph()); n != lemon::INVALID; ++n)
 		boundaryDistance(_graphVolume.positions()[n]) = 1.0;
 
 	if (_graphVolume.getDiscreteBoundingBox().depth() == 1) {
@@ -149,7 +182,7 @@ Skeletonize::initializeEdgeMap() {
 
 	// find center point with maximal boundary distance
 	_maxBoundaryDistance2 = 0;
-	for (GraphVolume::NodeIt node(_graphVolume.graph()); node != lemon::INVALID; ++node) {
+	for (NodeIt node(_graphVolume.graph()); node != lemon::INVALID; ++node) {
 
 		const Position& pos = _graphVolume.positions()[node];
 		if (boundaryDistance(pos) > _maxBoundaryDistance2) {
@@ -160,7 +193,7 @@ Skeletonize::initializeEdgeMap() {
 	}
 
 	// create initial edge map from boundary penalty
-	for (GraphVolume::EdgeIt e(_graphVolume.graph()); e != lemon::INVALID; ++e)
+	for (EdgeIt e(_graphVolume.graph()); e != lemon::INVALID; ++e)
 		_distanceMap[e] = boundaryPenalty(
 				0.5*(
 						boundaryDistance(_graphVolume.positions()[_graphVolume.graph().u(e)]) +
@@ -186,7 +219,7 @@ Skeletonize::initializeEdgeMap() {
 	nodeDistances[6] = sqrt(pow(_graphVolume.getResolutionX(), 2) + pow(_graphVolume.getResolutionY(), 2));
 	nodeDistances[7] = sqrt(pow(_graphVolume.getResolutionX(), 2) + pow(_graphVolume.getResolutionY(), 2) + pow(_graphVolume.getResolutionZ(), 2));
 
-	for (GraphVolume::EdgeIt e(_graphVolume.graph()); e != lemon::INVALID; ++e) {
+	for (EdgeIt e(_graphVolume.graph()); e != lemon::INVALID; ++e) {
 
 		Position u = _graphVolume.positions()[_graphVolume.graph().u(e)];
 		Position v = _graphVolume.positions()[_graphVolume.graph().v(e)];
@@ -200,15 +233,16 @@ Skeletonize::initializeEdgeMap() {
 	}
 }
 
+template <typename GraphVolumeType>
 void
-Skeletonize::findRoot() {
+BasicSkeletonize<GraphVolumeType>::findRoot() {
 
 	_dijkstra.run(_center);
 
 	// find furthest point on boundary
-	_root = GraphVolume::NodeIt(_graphVolume.graph());
+	_root = NodeIt(_graphVolume.graph());
 	float maxValue = -1;
-	for (GraphVolume::Node n : _boundary) {
+	for (Node n : _boundary) {
 		if (_dijkstra.distMap()[n] > maxValue) {
 
 			_root    = n;
@@ -225,15 +259,16 @@ Skeletonize::findRoot() {
 	_nodeLabels[_root] = OnSkeleton;
 }
 
+template <typename GraphVolumeType>
 bool
-Skeletonize::extractLongestSegment() {
+BasicSkeletonize<GraphVolumeType>::extractLongestSegment() {
 
 	_dijkstra.run(_root);
 
 	// find furthest point on boundary
-	GraphVolume::Node furthest = GraphVolume::NodeIt(_graphVolume.graph());
+	Node furthest = NodeIt(_graphVolume.graph());
 	float maxValue = -1;
-	for (GraphVolume::Node n : _boundary) {
+	for (Node n : _boundary) {
 
 		if (_parameters.skipExplainedNodes && _nodeLabels[n] == Explained)
 			continue;
@@ -251,7 +286,7 @@ Skeletonize::extractLongestSegment() {
 
 	LOG_DEBUG(skeletonizelog) << "extracting segment with length " << maxValue << std::endl;
 
-	GraphVolume::Node n = furthest;
+	Node n = furthest;
 
 	// walk backwards to next skeleton point
 	while (_nodeLabels[n] != OnSkeleton) {
@@ -261,9 +296,9 @@ Skeletonize::extractLongestSegment() {
 		if (_parameters.skipExplainedNodes)
 			drawExplanationSphere(_graphVolume.positions()[n]);
 
-		GraphVolume::Edge pred = _dijkstra.predMap()[n];
-		GraphVolume::Node u = _graphVolume.graph().u(pred);
-		GraphVolume::Node v = _graphVolume.graph().v(pred);
+		Edge pred = _dijkstra.predMap()[n];
+		Node u = _graphVolume.graph().u(pred);
+		Node v = _graphVolume.graph().v(pred);
 
 		n = (u == n ? v : u);
 
@@ -283,8 +318,9 @@ Skeletonize::extractLongestSegment() {
 	return true;
 }
 
+template <typename GraphVolumeType>
 void
-Skeletonize::drawExplanationSphere(const Position& center) {
+BasicSkeletonize<GraphVolumeType>::drawExplanationSphere(const Position& center) {
 
 	double radius2 = boundaryDistance(center)*pow(_parameters.explanationWeight, 2);
 
@@ -292,7 +328,7 @@ Skeletonize::drawExplanationSphere(const Position& center) {
 	double resY2 = pow(_graphVolume.getResolutionY(), 2);
 	double resZ2 = pow(_graphVolume.getResolutionZ(), 2);
 
-	for (GraphVolume::Node n : _boundary) {
+	for (Node n : _boundary) {
 
 		const Position& pos = _graphVolume.positions()[n];
 		double distance2 =
@@ -305,8 +341,9 @@ Skeletonize::drawExplanationSphere(const Position& center) {
 	}
 }
 
+template <typename GraphVolumeType>
 double
-Skeletonize::boundaryPenalty(double boundaryDistance) {
+BasicSkeletonize<GraphVolumeType>::boundaryPenalty(double boundaryDistance) {
 
 	// penalty = w*(1.0 - bd/max_bd)
 	//
@@ -316,8 +353,9 @@ Skeletonize::boundaryPenalty(double boundaryDistance) {
 	return _parameters.boundaryWeight*(1.0 - sqrt(boundaryDistance/_maxBoundaryDistance2));
 }
 
+template <typename GraphVolumeType>
 Skeleton
-Skeletonize::parseVolumeSkeleton() {
+BasicSkeletonize<GraphVolumeType>::parseVolumeSkeleton() {
 
 	Skeleton skeleton;
 
@@ -333,13 +371,14 @@ Skeletonize::parseVolumeSkeleton() {
 // overflows in stack restricted environments (e.g. multithreading).  The
 // current version is a fairly direct iteratization of the old, directly
 // recursive version.
+template <typename GraphVolumeType>
 void
-Skeletonize::traverse(const GraphVolume::Node& root, Skeleton& skeleton) {
+BasicSkeletonize<GraphVolumeType>::traverse(const Node& root, Skeleton& skeleton) {
 	// DFS of nodes from root.  Data-wise, Nodes are just integer values.
-	std::stack<GraphVolume::Node> traversal;
+	std::stack<Node> traversal;
 	traversal.push(root);
 	while (!traversal.empty()) {
-		const GraphVolume::Node n = traversal.top();
+		const Node n = traversal.top();
 		const int nNeighbors = numNeighbors(n);
 
 		// Special nodes that open new segments.
@@ -366,7 +405,7 @@ Skeletonize::traverse(const GraphVolume::Node& root, Skeleton& skeleton) {
 
 		// Iterate through neighbors and put unseen ones onto traversal stack.  The
 		// loop checks against nNeighbors to allow early termination.
-		GraphVolume::IncEdgeIt e(_graphVolume.graph(), n);
+		IncEdgeIt e(_graphVolume.graph(), n);
 		for (int i = 0; i < nNeighbors; ++e /* increment e, not i */) {
 			assert(e != lemon::INVALID);  // Should never occur.
 
@@ -374,21 +413,25 @@ Skeletonize::traverse(const GraphVolume::Node& root, Skeleton& skeleton) {
 			if (_distanceMap[e] != 0.0) continue;
 			++i;
 
-			const GraphVolume::Node neighbor = (_graphVolume.graph().u(e) == n ? _graphVolume.graph().v(e) : _graphVolume.graph().u(e));
+			const Node neighbor = (_graphVolume.graph().u(e) == n ? _graphVolume.graph().v(e) : _graphVolume.graph().u(e));
 			if (_nodeLabels[neighbor] != Visited) traversal.push(neighbor);
 		}
 	}
 }
 
+template <typename GraphVolumeType>
 int
-Skeletonize::numNeighbors(const GraphVolume::Node& n) {
+BasicSkeletonize<GraphVolumeType>::numNeighbors(const Node& n) {
 
 	int num = 0;
 
-	for (GraphVolume::IncEdgeIt e(_graphVolume.graph(), n); e != lemon::INVALID; ++e)
+	for (IncEdgeIt e(_graphVolume.graph(), n); e != lemon::INVALID; ++e)
 		if (_distanceMap[e] == 0.0)
 			num++;
 
 	return num;
 }
 
+template class BasicSkeletonize<GraphVolume>;
+template class BasicSkeletonize<CompactGraphVolume>;
+template class BasicSkeletonize<ImplicitGraphVolume>;
@@ -6,16 +6,28 @@
 #define USE_PROGRAM_OPTIONS
 #include <lemon/dijkstra.h>
 #include <util/exceptions.h>
+#include "CompactGraphVolume.h"
+#include "ImplicitGraphVolume.h"
 #include "Skeleton.h"
 
 class NoNodeFound : public Exception {};
 
-
-class Skeletonize {
-
-	typedef vigra::MultiArray<3, unsigned char> VolumeType;
-	typedef GraphVolume::Position               Position;
-	typedef GraphVolume::Graph::EdgeMap<double> DistanceMap;
+/**
+ * Extracts a skeleton from a graph volume. Works on GraphVolumes, 
+ * CompactGraphVolumes, and ImplicitGraphVolumes, see the typedefs below.
+ */
+template <typename GraphVolumeType>
+class BasicSkeletonize {
+
+	typedef vigra::MultiArray<3, unsigned char>      VolumeType;
+	typedef typename GraphVolumeType::Graph          Graph;
+	typedef typename GraphVolumeType::Position       Position;
+	typedef typename Graph::Node                     Node;
+	typedef typename Graph::Edge                     Edge;
+	typedef typename Graph::NodeIt                   NodeIt;
+	typedef typename Graph::EdgeIt                   EdgeIt;
+	typedef typename Graph::IncEdgeIt                IncEdgeIt;
+	typedef typename Graph::template EdgeMap<double> DistanceMap;
 
 public:
 
@@ -33,8 +45,8 @@ public:
 	 * Create a skeletonizer for the given volume. Inside voxels are assumed to 
 	 * be labelled with 1, background with 0.
 	 */
-	Skeletonize(const GraphVolume& graph);
-	Skeletonize(const GraphVolume& graphVolume, Parameters user_parameters);
+	BasicSkeletonize(const GraphVolumeType& graph);
+	BasicSkeletonize(const GraphVolumeType& graphVolume, Parameters user_parameters);
 
 	/**
 	 * Extract the skeleton from the given volume.
@@ -116,33 +128,51 @@ private:
 	/**
 	 * Recursively discover the skeleton graph from the volume annotations.
 	 */
-	void traverse(const GraphVolume::Node& n, Skeleton& skeleton);
+	void traverse(const Node& n, Skeleton& skeleton);
 
 	/**
 	 * The number of neighbors of a skeleton position in the volume.
 	 */
-	int numNeighbors(const GraphVolume::Node& n);
+	int numNeighbors(const Node& n);
 
 	// interior boundary distances
 	vigra::MultiArray<3, float> _boundaryDistance;
 
+	// a deep copy of the graph volume, if it was shared with other copies, 
+	// such that maps are not attached to a graph used by other threads
+	std::unique_ptr<GraphVolumeType> _unsharedGraphVolume;
+
 	// lemon graph compatible datastructures for Dijkstra
-	const GraphVolume& _graphVolume;
+	const GraphVolumeType& _graphVolume;
 	DistanceMap _distanceMap;
 
-	lemon::Dijkstra<GraphVolume::Graph, DistanceMap> _dijkstra;
+	lemon::Dijkstra<Graph, DistanceMap> _dijkstra;
 
-	GraphVolume::Graph::Node _root;
-	GraphVolume::Graph::Node _center;
+	Node _root;
+	Node _center;
 
-	GraphVolume::Graph::NodeMap<NodeLabel> _nodeLabels;
+	typename Graph::template NodeMap<NodeLabel> _nodeLabels;
 
-	std::vector<GraphVolume::Graph::Node> _boundary;
+	std::vector<Node> _boundary;
 	
 	Parameters _parameters;
 	float _maxBoundaryDistance2;
 
 };
 
+/**
+ * Extracts a skeleton from a GraphVolume. A class rather than a typedef, such 
+ * that it can be forward declared.
+ */
+class Skeletonize : public BasicSkeletonize<GraphVolume> {
+
+public:
+
+	using BasicSkeletonize<GraphVolume>::BasicSkeletonize;
+};
+
+typedef BasicSkeletonize<CompactGraphVolume>  CompactSkeletonize;
+typedef BasicSkeletonize<ImplicitGraphVolume> ImplicitSkeletonize;
+
 #endif // IMAGEPROCESSING_TUBES_SKELETONIZE_H__
 
@@ -0,0 +1,78 @@
+#ifndef IMAGEPROCESSING_UNION_FIND_H__
+#define IMAGEPROCESSING_UNION_FIND_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * A disjoint-set forest over consecutive ids. The representative of a set is 
+ * always its smallest id.
+ */
+class UnionFind {
+
+public:
+
+	/**
+	 * Create a union-find structure with the given number of singleton sets.
+	 */
+	explicit UnionFind(std::size_t size = 0) :
+		_parents(size) {
+
+		for (std::size_t i = 0; i < size; i++)
+			_parents[i] = i;
+	}
+
+	/**
+	 * Add a new singleton set and return its id.
+	 */
+	std::size_t add() {
+
+		_parents.push_back(_parents.size());
+		return _parents.size() - 1;
+	}
+
+	/**
+	 * Find the representative of the set containing i.
+	 */
+	std::size_t find(std::size_t i) {
+
+		// path halving
+		while (_parents[i] != i) {
+
+			_parents[i] = _parents[_parents[i]];
+			i = _parents[i];
+		}
+
+		return i;
+	}
+
+	/**
+	 * Merge the sets containing a and b. Returns the representative of the 
+	 * merged set.
+	 */
+	std::size_t merge(std::size_t a, std::size_t b) {
+
+		a = find(a);
+		b = find(b);
+
+		if (a < b)
+			_parents[b] = a;
+		else
+			_parents[a] = b;
+
+		return std::min(a, b);
+	}
+
+	/**
+	 * The number of ids.
+	 */
+	std::size_t size() const { return _parents.size(); }
+
+private:
+
+	std::vector<std::size_t> _parents;
+};
+
+#endif // IMAGEPROCESSING_UNION_FIND_H__
+
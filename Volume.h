@@ -1,6 +1,8 @@
 #ifndef IMAGEPROCESSING_VOLUME_H__
 #define IMAGEPROCESSING_VOLUME_H__
 
+#include <atomic>
+#include <mutex>
 #include <util/box.hpp>
 
 /**
@@ -14,18 +16,35 @@ public:
 		_boundingBoxDirty(true) {}
 
 	Volume(const Volume& other) :
-		_boundingBox(other._boundingBox),
-		_boundingBoxDirty(other._boundingBoxDirty) {}
+		_boundingBoxDirty(true) {
+
+		copyBoundingBox(other);
+	}
+
+	Volume& operator=(const Volume& other) {
+
+		if (this != &other)
+			copyBoundingBox(other);
+
+		return *this;
+	}
 
 	/**
-	 * Get the bounding box of this volume.
+	 * Get the bounding box of this volume. Safe to call from several threads 
+	 * at the same time: the first caller computes the bounding box, later 
+	 * callers read it without locking.
 	 */
 	const util::box<float,3>& getBoundingBox() const {
 
-		if (_boundingBoxDirty) {
+		if (_boundingBoxDirty.load(std::memory_order_acquire)) {
+
+			std::lock_guard<std::mutex> lock(_boundingBoxMutex);
+
+			if (_boundingBoxDirty.load(std::memory_order_relaxed)) {
 
-			_boundingBox = computeBoundingBox();
-			_boundingBoxDirty = false;
+				_boundingBox = computeBoundingBox();
+				_boundingBoxDirty.store(false, std::memory_order_release);
+			}
 		}
 
 		return _boundingBox;
@@ -33,9 +52,10 @@ public:
 
 	/**
 	 * Indicate that the bounding box changed and needs to be recomputed the 
-	 * next time it is queried.
+	 * next time it is queried. Like all modifications, this must not happen 
+	 * while other threads read from this volume.
 	 */
-	void setBoundingBoxDirty() { _boundingBoxDirty = true; }
+	void setBoundingBoxDirty() { _boundingBoxDirty.store(true, std::memory_order_release); }
 
 protected:
 
@@ -47,6 +67,16 @@ protected:
 
 private:
 
+	void copyBoundingBox(const Volume& other) {
+
+		std::lock_guard<std::mutex> lock(other._boundingBoxMutex);
+
+		bool dirty = other._boundingBoxDirty.load(std::memory_order_acquire);
+		if (!dirty)
+			_boundingBox = other._boundingBox;
+		_boundingBoxDirty.store(dirty, std::memory_order_release);
+	}
+
 	/**
 	 * Since we want the bounding box to be computed as needed, even in a const 
 	 * setting, we make it mutable.
@@ -54,9 +84,15 @@ private:
 	mutable util::box<float,3> _boundingBox;
 
 	/**
-	 * Same for the dirty flag.
+	 * Same for the dirty flag, which publishes the bounding box to other 
+	 * threads once it is computed.
+	 */
+	mutable std::atomic<bool> _boundingBoxDirty;
+
+	/**
+	 * Serializes the computation of the bounding box.
 	 */
-	mutable bool _boundingBoxDirty;
+	mutable std::mutex _boundingBoxMutex;
 };
 
 
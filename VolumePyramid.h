@@ -0,0 +1,202 @@
+#ifndef IMAGEPROCESSING_VOLUME_PYRAMID_H__
+#define IMAGEPROCESSING_VOLUME_PYRAMID_H__
+
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include <util/exceptions.h>
+#include "ExplicitVolume.h"
+#include "parallel.h"
+
+/**
+ * A multiscale representation of an ExplicitVolume. Level 0 is the volume 
+ * itself, each following level is downsampled by a factor of two in each 
+ * direction. Levels are created on demand and cached.
+ *
+ * Every voxel of a level covers 2x2x2 voxels of the previous level, with the 
+ * same offset and twice the resolution. Voxels on the upper borders of odd 
+ * sized volumes cover less voxels of the previous level.
+ */
+template <typename ValueType>
+class VolumePyramid {
+
+public:
+
+	/**
+	 * How to combine voxels when downsampling.
+	 */
+	enum Mode {
+
+		/**
+		 * Use the mean value, suitable for intensities.
+		 */
+		Mean,
+
+		/**
+		 * Use the most frequent value, suitable for labels. Ties are broken in 
+		 * favor of the value that was seen first.
+		 */
+		MostFrequent
+	};
+
+	/**
+	 * Create a pyramid for the given volume. The volume must not be changed 
+	 * while the pyramid is in use.
+	 */
+	VolumePyramid(std::shared_ptr<const ExplicitVolume<ValueType> > volume, Mode mode) :
+		_mode(mode),
+		_maxLevel(computeMaxLevel(*volume)),
+		_levels(_maxLevel + 1) {
+
+		_levels[0] = volume;
+	}
+
+	/**
+	 * Get a level of the pyramid. Creates all missing levels up to the given 
+	 * one. Levels that have been created before are returned without locking. 
+	 * Can be called concurrently.
+	 */
+	const ExplicitVolume<ValueType>& getLevel(unsigned int level) {
+
+		if (level > _maxLevel)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"level " << level << " exceeds the maximal level " << _maxLevel);
+
+		std::shared_ptr<const ExplicitVolume<ValueType> > cached = std::atomic_load(&_levels[level]);
+		if (cached)
+			return *cached;
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// levels are created in order, find the last one that exists
+		unsigned int existing = level;
+		while (!std::atomic_load(&_levels[existing]))
+			existing--;
+
+		for (unsigned int l = existing + 1; l <= level; l++)
+			std::atomic_store(&_levels[l], downsample(*_levels[l - 1]));
+
+		return *_levels[level];
+	}
+
+	/**
+	 * The level at which the volume is reduced to a single voxel.
+	 */
+	unsigned int getMaxLevel() const { return _maxLevel; }
+
+	/**
+	 * The number of levels that have been created so far.
+	 */
+	unsigned int getNumCachedLevels() const {
+
+		unsigned int numLevels = 0;
+		while (numLevels <= _maxLevel && std::atomic_load(&_levels[numLevels]))
+			numLevels++;
+
+		return numLevels;
+	}
+
+private:
+
+	static unsigned int computeMaxLevel(const ExplicitVolume<ValueType>& volume) {
+
+		unsigned int size  = std::max(volume.width(), std::max(volume.height(), volume.depth()));
+		unsigned int level = 0;
+		while (size > 1) {
+
+			size = (size + 1)/2;
+			level++;
+		}
+
+		return level;
+	}
+
+	std::shared_ptr<const ExplicitVolume<ValueType> > downsample(const ExplicitVolume<ValueType>& source) const {
+
+		unsigned int width  = (source.width()  + 1)/2;
+		unsigned int height = (source.height() + 1)/2;
+		unsigned int depth  = (source.depth()  + 1)/2;
+
+		auto target = std::make_shared<ExplicitVolume<ValueType> >(width, height, depth);
+		target->setResolution(
+				2*source.getResolutionX(),
+				2*source.getResolutionY(),
+				2*source.getResolutionZ());
+		target->setOffset(source.getOffset());
+
+		parallelFor(0, depth, [&](std::size_t beginZ, std::size_t endZ) {
+
+			ValueType values[8];
+
+			for (unsigned int z = beginZ; z < endZ; z++)
+			for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width; x++) {
+
+				// collect the values of the source block
+				int numValues = 0;
+				for (unsigned int sz = 2*z; sz < std::min(2*z + 2, source.depth());  sz++)
+				for (unsigned int sy = 2*y; sy < std::min(2*y + 2, source.height()); sy++)
+				for (unsigned int sx = 2*x; sx < std::min(2*x + 2, source.width());  sx++)
+					values[numValues++] = source(sx, sy, sz);
+
+				(*target)(x, y, z) = (_mode == Mean ? mean(values, numValues) : mostFrequent(values, numValues));
+			}
+		},
+		std::max<std::size_t>((1 << 16)/(width*height + 1), 1));
+
+		return target;
+	}
+
+	static ValueType mean(const ValueType* values, int numValues) {
+
+		double sum = 0;
+		for (int i = 0; i < numValues; i++)
+			sum += values[i];
+
+		double mean = sum/numValues;
+
+		if (std::is_integral<ValueType>::value)
+			mean = std::round(mean);
+
+		return static_cast<ValueType>(mean);
+	}
+
+	static ValueType mostFrequent(const ValueType* values, int numValues) {
+
+		ValueType best      = values[0];
+		int       bestCount = 0;
+
+		for (int i = 0; i < numValues; i++) {
+
+			int count = 0;
+			for (int j = i; j < numValues; j++)
+				if (values[j] == values[i])
+					count++;
+
+			if (count > bestCount) {
+
+				best      = values[i];
+				bestCount = count;
+			}
+		}
+
+		return best;
+	}
+
+	Mode _mode;
+
+	unsigned int _maxLevel;
+
+	// one entry per level, never resized, such that created levels can be 
+	// read without locking (through atomic_load)
+	std::vector<std::shared_ptr<const ExplicitVolume<ValueType> > > _levels;
+
+	// serializes the creation of levels
+	std::mutex _mutex;
+};
+
+#endif // IMAGEPROCESSING_VOLUME_PYRAMID_H__
+
@@ -0,0 +1,70 @@
+#ifndef IMAGEPROCESSING_BLOCKED_COPY_H__
+#define IMAGEPROCESSING_BLOCKED_COPY_H__
+
+#include <algorithm>
+#include <vigra/multi_array.hxx>
+#include <util/exceptions.h>
+#include "parallel.h"
+
+/**
+ * Copy (and convert) the values of a 3D multi-array view into another one of 
+ * the same shape. The copy proceeds in cubic blocks, such that reading and 
+ * writing stay cache-local even if the memory layouts of source and target 
+ * differ, e.g., when copying from a z-major into an x-major array. Blocks are 
+ * copied in parallel.
+ */
+template <typename S, typename SourceTag, typename T, typename TargetTag>
+void blockedCopy(
+		const vigra::MultiArrayView<3, S, SourceTag>& source,
+		vigra::MultiArrayView<3, T, TargetTag>        target) {
+
+	typedef vigra::MultiArrayIndex Index;
+
+	if (source.shape() != target.shape())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"source and target of copy have different shapes");
+
+	const Index width  = target.shape(0);
+	const Index height = target.shape(1);
+	const Index depth  = target.shape(2);
+
+	const Index ss0 = source.stride(0), ss1 = source.stride(1), ss2 = source.stride(2);
+	const Index ts0 = target.stride(0), ts1 = target.stride(1), ts2 = target.stride(2);
+
+	// rows that are contiguous in both arrays don't need to be split
+	const Index blockSize  = 32;
+	const Index blockWidth = (ss0 == 1 && ts0 == 1 ? width : blockSize);
+
+	// process slabs of blocks along z in parallel, but don't start threads 
+	// for small arrays
+	const Index numSlabs    = (depth + blockSize - 1)/blockSize;
+	const Index slabSize    = std::max<Index>(width*height*blockSize, 1);
+	const Index minNumSlabs = std::max<Index>((1 << 16)/slabSize, 1);
+
+	parallelFor(0, numSlabs, [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (Index bz = beginSlab*blockSize; bz < std::min<Index>(endSlab*blockSize, depth); bz += blockSize)
+		for (Index by = 0; by < height; by += blockSize)
+		for (Index bx = 0; bx < width;  bx += blockWidth) {
+
+			const Index ez = std::min(bz + blockSize,  depth);
+			const Index ey = std::min(by + blockSize,  height);
+			const Index ex = std::min(bx + blockWidth, width);
+
+			for (Index z = bz; z < ez; z++)
+			for (Index y = by; y < ey; y++) {
+
+				const S* s = source.data() + y*ss1 + z*ss2;
+				T*       t = target.data() + y*ts1 + z*ts2;
+
+				for (Index x = bx; x < ex; x++)
+					t[x*ts0] = static_cast<T>(s[x*ss0]);
+			}
+		}
+	},
+	minNumSlabs);
+}
+
+#endif // IMAGEPROCESSING_BLOCKED_COPY_H__
+
@@ -0,0 +1,310 @@
+#ifndef IMAGEPROCESSING_CONNECTED_COMPONENTS_H__
+#define IMAGEPROCESSING_CONNECTED_COMPONENTS_H__
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <util/box.hpp>
+#include <util/exceptions.h>
+#include "ExplicitVolume.h"
+#include "UnionFind.h"
+#include "connectivity.h"
+#include "parallel.h"
+
+/**
+ * Statistics of a connected component, in discrete coordinates of the 
+ * labelled volume.
+ */
+struct ComponentStatistics {
+
+	/**
+	 * The number of voxels of the component.
+	 */
+	std::size_t size = 0;
+
+	/**
+	 * The discrete bounding box of the component.
+	 */
+	util::box<unsigned int,3> boundingBox;
+
+	/**
+	 * The mean discrete coordinates of the voxels of the component.
+	 */
+	util::point<float,3> centroid;
+};
+
+/**
+ * Label the connected components of the non-zero voxels of a volume, and 
+ * compute statistics for each component in the same pass.
+ *
+ * The volume is split into slabs along z, which are labelled in parallel.  
+ * Components are then merged across slab borders with a union-find structure.  
+ * The resulting labels are consecutive, starting from 1, in the order in which 
+ * the components are first encountered in scan order. Background voxels are 
+ * labelled 0.
+ *
+ * @param[in] volume
+ *              The volume to label.
+ * @param[out] labels
+ *              The label volume, gets the size, resolution, and offset of the 
+ *              volume. LabelType has to be large enough to hold the number of 
+ *              components.
+ * @param[in] connectivity
+ *              Which voxels are considered neighbors.
+ *
+ * @return The statistics of each component, indexed by label. Entry 0 belongs 
+ *         to the background and is left empty.
+ */
+template <typename T, typename LabelType>
+std::vector<ComponentStatistics>
+labelConnectedComponents(
+		const ExplicitVolume<T>&   volume,
+		ExplicitVolume<LabelType>& labels,
+		Connectivity connectivity = Connectivity26) {
+
+	const int width  = volume.width();
+	const int height = volume.height();
+	const int depth  = volume.depth();
+
+	labels.resize(width, height, depth);
+	labels.data() = 0;
+	labels.setResolution(volume.getResolution());
+	labels.setOffset(volume.getOffset());
+
+	if (depth == 0)
+		return std::vector<ComponentStatistics>(1);
+
+	const std::vector<util::point<int,3> > neighbors = getPrecedingNeighborOffsets(connectivity);
+	const std::size_t maxLabel = std::numeric_limits<LabelType>::max();
+
+	// accumulated statistics of a component
+	struct Accumulator {
+
+		std::size_t  size = 0;
+		unsigned int min[3];
+		unsigned int max[3];
+		double       sum[3] = { 0, 0, 0 };
+
+		void add(unsigned int x, unsigned int y, unsigned int z) {
+
+			unsigned int p[3] = { x, y, z };
+			for (int i = 0; i < 3; i++) {
+
+				min[i]  = (size == 0 ? p[i] : std::min(min[i], p[i]));
+				max[i]  = (size == 0 ? p[i] : std::max(max[i], p[i]));
+				sum[i] += p[i];
+			}
+			size++;
+		}
+
+		void add(const Accumulator& other) {
+
+			if (other.size == 0)
+				return;
+
+			for (int i = 0; i < 3; i++) {
+
+				min[i]  = (size == 0 ? other.min[i] : std::min(min[i], other.min[i]));
+				max[i]  = (size == 0 ? other.max[i] : std::max(max[i], other.max[i]));
+				sum[i] += other.sum[i];
+			}
+			size += other.size;
+		}
+	};
+
+	struct Slab {
+
+		int begin;
+		int end;
+
+		// equivalences of the provisional labels in this slab, the voxels 
+		// store provisional label + 1
+		UnionFind provisional;
+
+		// map from provisional labels to consecutive ids of their components 
+		// within this slab
+		std::vector<std::size_t> componentIds;
+
+		// statistics per component within this slab
+		std::vector<Accumulator> statistics;
+	};
+
+	const int numSlabs = std::min<int>(numParallelThreads(), depth);
+	std::vector<Slab> slabs(numSlabs);
+	for (int s = 0; s < numSlabs; s++) {
+
+		slabs[s].begin = static_cast<long>(s)*depth/numSlabs;
+		slabs[s].end   = static_cast<long>(s + 1)*depth/numSlabs;
+	}
+
+	// label each slab independently
+	parallelFor(0, numSlabs, [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (std::size_t s = beginSlab; s < endSlab; s++) {
+
+			Slab& slab = slabs[s];
+
+			for (int z = slab.begin; z < slab.end; z++)
+			for (int y = 0; y < height; y++)
+			for (int x = 0; x < width;  x++) {
+
+				if (volume(x, y, z) == 0)
+					continue;
+
+				bool        found = false;
+				std::size_t label = 0;
+
+				for (const util::point<int,3>& offset : neighbors) {
+
+					int nx = x + offset.x();
+					int ny = y + offset.y();
+					int nz = z + offset.z();
+
+					if (nx < 0 || nx >= width || ny < 0 || ny >= height || nz < slab.begin)
+						continue;
+
+					LabelType neighborLabel = labels(nx, ny, nz);
+					if (neighborLabel == 0)
+						continue;
+
+					label = (found ? slab.provisional.merge(label, neighborLabel - 1) : slab.provisional.find(neighborLabel - 1));
+					found = true;
+				}
+
+				if (!found) {
+
+					label = slab.provisional.add();
+
+					if (label + 1 > maxLabel)
+						UTIL_THROW_EXCEPTION(
+								UsageError,
+								"label type is too small for the number of provisional labels");
+				}
+
+				labels(x, y, z) = label + 1;
+			}
+
+			// enumerate the components of this slab
+			std::size_t numComponents = 0;
+			slab.componentIds.resize(slab.provisional.size());
+			for (std::size_t l = 0; l < slab.provisional.size(); l++) {
+
+				// representatives are the smallest ids of their sets, and thus 
+				// visited before all other members
+				std::size_t root = slab.provisional.find(l);
+				slab.componentIds[l] = (root == l ? numComponents++ : slab.componentIds[root]);
+			}
+			slab.statistics.resize(numComponents);
+		}
+	},
+	1);
+
+	// global ids of the slab components
+	std::vector<std::size_t> slabOffsets(numSlabs + 1, 0);
+	for (int s = 0; s < numSlabs; s++)
+		slabOffsets[s + 1] = slabOffsets[s] + slabs[s].statistics.size();
+
+	auto globalId = [&](int s, LabelType label) {
+
+		return slabOffsets[s] + slabs[s].componentIds[label - 1];
+	};
+
+	// merge components across slab borders
+	UnionFind components(slabOffsets[numSlabs]);
+	for (int s = 1; s < numSlabs; s++) {
+
+		int z = slabs[s].begin;
+
+		for (int y = 0; y < height; y++)
+		for (int x = 0; x < width;  x++) {
+
+			LabelType label = labels(x, y, z);
+			if (label == 0)
+				continue;
+
+			for (const util::point<int,3>& offset : neighbors) {
+
+				int nx = x + offset.x();
+				int ny = y + offset.y();
+
+				if (offset.z() == 0 || nx < 0 || nx >= width || ny < 0 || ny >= height)
+					continue;
+
+				LabelType neighborLabel = labels(nx, ny, z - 1);
+				if (neighborLabel != 0)
+					components.merge(globalId(s, label), globalId(s - 1, neighborLabel));
+			}
+		}
+	}
+
+	// assign consecutive final labels, in scan order of the components
+	std::vector<LabelType> finalLabels(components.size());
+	std::size_t numLabels = 0;
+	for (std::size_t c = 0; c < components.size(); c++) {
+
+		std::size_t root = components.find(c);
+
+		if (root == c) {
+
+			if (numLabels + 1 > maxLabel)
+				UTIL_THROW_EXCEPTION(
+						UsageError,
+						"label type is too small for the number of components");
+
+			finalLabels[c] = ++numLabels;
+
+		} else {
+
+			finalLabels[c] = finalLabels[root];
+		}
+	}
+
+	// relabel and collect statistics per slab
+	parallelFor(0, numSlabs, [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (std::size_t s = beginSlab; s < endSlab; s++) {
+
+			Slab& slab = slabs[s];
+
+			for (int z = slab.begin; z < slab.end; z++)
+			for (int y = 0; y < height; y++)
+			for (int x = 0; x < width;  x++) {
+
+				LabelType& label = labels(x, y, z);
+				if (label == 0)
+					continue;
+
+				std::size_t component = slab.componentIds[label - 1];
+				slab.statistics[component].add(x, y, z);
+				label = finalLabels[slabOffsets[s] + component];
+			}
+		}
+	},
+	1);
+
+	// merge statistics
+	std::vector<Accumulator> accumulators(numLabels + 1);
+	for (int s = 0; s < numSlabs; s++)
+		for (std::size_t c = 0; c < slabs[s].statistics.size(); c++)
+			accumulators[finalLabels[slabOffsets[s] + c]].add(slabs[s].statistics[c]);
+
+	std::vector<ComponentStatistics> statistics(numLabels + 1);
+	for (std::size_t l = 1; l <= numLabels; l++) {
+
+		const Accumulator& accumulator = accumulators[l];
+
+		statistics[l].size = accumulator.size;
+		statistics[l].boundingBox = util::box<unsigned int,3>(
+				accumulator.min[0],     accumulator.min[1],     accumulator.min[2],
+				accumulator.max[0] + 1, accumulator.max[1] + 1, accumulator.max[2] + 1);
+		statistics[l].centroid = util::point<float,3>(
+				accumulator.sum[0]/accumulator.size,
+				accumulator.sum[1]/accumulator.size,
+				accumulator.sum[2]/accumulator.size);
+	}
+
+	return statistics;
+}
+
+#endif // IMAGEPROCESSING_CONNECTED_COMPONENTS_H__
+
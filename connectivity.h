@@ -0,0 +1,57 @@
+#ifndef IMAGEPROCESSING_CONNECTIVITY_H__
+#define IMAGEPROCESSING_CONNECTIVITY_H__
+
+#include <cstdlib>
+#include <vector>
+#include <util/point.hpp>
+
+/**
+ * Neighborhoods of voxels on a 3D grid: voxels sharing a face (6), a face or 
+ * an edge (18), or a face, an edge, or a corner (26).
+ */
+enum Connectivity {
+
+	Connectivity6  = 6,
+	Connectivity18 = 18,
+	Connectivity26 = 26
+};
+
+/**
+ * Get the offsets to all neighbors of a voxel for the given connectivity.
+ */
+inline std::vector<util::point<int,3> > getNeighborOffsets(Connectivity connectivity) {
+
+	// the maximal number of coordinates a neighbor differs in
+	int maxDifferent = (connectivity == Connectivity6 ? 1 : (connectivity == Connectivity18 ? 2 : 3));
+
+	std::vector<util::point<int,3> > offsets;
+	for (int dz = -1; dz <= 1; dz++)
+	for (int dy = -1; dy <= 1; dy++)
+	for (int dx = -1; dx <= 1; dx++) {
+
+		int numDifferent = std::abs(dx) + std::abs(dy) + std::abs(dz);
+		if (numDifferent > 0 && numDifferent <= maxDifferent)
+			offsets.push_back(util::point<int,3>(dx, dy, dz));
+	}
+
+	return offsets;
+}
+
+/**
+ * Get the offsets to the neighbors of a voxel that precede it in scan order (x 
+ * changes fastest, z slowest) for the given connectivity. These are half of 
+ * the neighbors, such that visiting them for each voxel visits each pair of 
+ * neighbors exactly once.
+ */
+inline std::vector<util::point<int,3> > getPrecedingNeighborOffsets(Connectivity connectivity) {
+
+	std::vector<util::point<int,3> > offsets;
+	for (const util::point<int,3>& offset : getNeighborOffsets(connectivity))
+		if (offset.z() < 0 || (offset.z() == 0 && (offset.y() < 0 || (offset.y() == 0 && offset.x() < 0))))
+			offsets.push_back(offset);
+
+	return offsets;
+}
+
+#endif // IMAGEPROCESSING_CONNECTIVITY_H__
+
@@ -11,5 +11,7 @@ struct ImageProcessingError : virtual Exception {};
 
 struct InvalidOperation : virtual ImageProcessingError {};
 
+struct FileAccessError : virtual ImageProcessingError {};
+
 #endif // IMAGEPROCESSING_EXCEPTIONS_H__
 
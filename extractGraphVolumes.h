@@ -0,0 +1,228 @@
+#ifndef IMAGEPROCESSING_EXTRACT_GRAPH_VOLUMES_H__
+#define IMAGEPROCESSING_EXTRACT_GRAPH_VOLUMES_H__
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ExplicitVolume.h"
+#include "GraphVolume.h"
+#include "connectivity.h"
+#include "parallel.h"
+
+/**
+ * Create one GraphVolume per label of a label volume, without creating a mask
+ * for each label first (see extractObjects()). Nodes are connected to
+ * neighboring nodes of the same label only. The positions of the nodes are
+ * the discrete coordinates in the label volume, and each graph volume has the
+ * offset and resolution of the label volume, as if created from a mask of the
+ * size of the label volume.
+ *
+ * The label volume is scanned in parallel slabs to collect the nodes and to
+ * count the edges of each label per slab. The graph volumes are then filled
+ * in parallel, one label per thread. The total cost is linear in the size of
+ * the volume.
+ *
+ * @param labels
+ *              The label volume. Voxels with label 0 are considered
+ *              background.
+ *
+ * @param connectivity
+ *              The connectivity of the nodes of each graph volume.
+ *
+ * @return A graph volume for each label.
+ */
+template <typename T>
+std::map<T, GraphVolume>
+extractGraphVolumes(
+		const ExplicitVolume<T>& labels,
+		Connectivity connectivity = Connectivity26) {
+
+	typedef GraphVolume::Position Position;
+
+	// the part of an object within a slab
+	struct SlabObject {
+
+		std::vector<Position> nodes;
+		std::size_t           numEdges  = 0;
+
+		// the id of the first node of this part in the graph of the object
+		int                   firstNode = 0;
+	};
+
+	typedef std::unordered_map<T, SlabObject> SlabObjects;
+
+	const int width  = labels.width();
+	const int height = labels.height();
+	const int depth  = labels.depth();
+
+	std::map<T, GraphVolume> graphVolumes;
+
+	if (width == 0 || height == 0 || depth == 0)
+		return graphVolumes;
+
+	const std::vector<util::point<int,3> > neighbors = getPrecedingNeighborOffsets(connectivity);
+
+	const std::size_t numSlabs = std::max<std::size_t>(std::min<std::size_t>(numParallelThreads(), depth), 1);
+	std::vector<SlabObjects> slabObjects(numSlabs);
+
+	auto slabBegin = [&](std::size_t s) { return static_cast<int>(s*depth/numSlabs); };
+	auto slabEnd   = [&](std::size_t s) { return static_cast<int>((s + 1)*depth/numSlabs); };
+
+	// collect the nodes and count the edges of each label per slab
+	parallelFor(0, numSlabs, [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (std::size_t s = beginSlab; s < endSlab; s++) {
+
+			SlabObjects& objects = slabObjects[s];
+
+			for (int z = slabBegin(s); z < slabEnd(s); z++)
+			for (int y = 0; y < height; y++) {
+
+				// consecutive voxels mostly have the same label, avoid hash
+				// lookups for them
+				T           previous = 0;
+				SlabObject* object   = 0;
+
+				for (int x = 0; x < width; x++) {
+
+					T label = labels(x, y, z);
+					if (label == 0)
+						continue;
+
+					if (label != previous || object == 0) {
+
+						object   = &objects[label];
+						previous = label;
+					}
+
+					object->nodes.push_back(Position(x, y, z));
+
+					for (const util::point<int,3>& offset : neighbors) {
+
+						int nx = x + offset.x();
+						int ny = y + offset.y();
+						int nz = z + offset.z();
+
+						if (nx >= 0 && nx < width && ny >= 0 && ny < height && nz >= 0 && labels(nx, ny, nz) == label)
+							object->numEdges++;
+					}
+				}
+			}
+		}
+	},
+	1);
+
+	// create the graph volumes and number the nodes of each label across slabs
+	std::map<T, std::pair<std::size_t, std::size_t> > sizes;
+
+	for (SlabObjects& objects : slabObjects)
+		for (auto& p : objects) {
+
+			std::pair<std::size_t, std::size_t>& size = sizes[p.first];
+
+			p.second.firstNode  = size.first;
+			size.first         += p.second.nodes.size();
+			size.second        += p.second.numEdges;
+		}
+
+	// the label, number of nodes, and number of edges of each graph volume, 
+	// such that they can be read in parallel without map lookups
+	std::vector<T>            ids;
+	std::vector<std::size_t>  numNodes;
+	std::vector<std::size_t>  numEdges;
+	std::vector<GraphVolume*> todo;
+
+	for (const auto& p : sizes) {
+
+		GraphVolume& graphVolume = graphVolumes.emplace(p.first, connectivity).first->second;
+		graphVolume.setOffset(labels.getOffset());
+		graphVolume.setResolution(labels.getResolution());
+
+		ids.push_back(p.first);
+		numNodes.push_back(p.second.first);
+		numEdges.push_back(p.second.second);
+		todo.push_back(&graphVolume);
+	}
+
+	// test whether a position comes before (x, y, z) in scan order
+	auto before = [](const Position& position, long x, long y, long z) {
+
+		return
+				position.z() < z ||
+				(position.z() == z && (position.y() < y || (position.y() == y && position.x() < x)));
+	};
+
+	// fill the graph volumes
+	parallelFor(0, ids.size(), [&](std::size_t begin, std::size_t end) {
+
+		for (std::size_t i = begin; i < end; i++) {
+
+			const T label = ids[i];
+			GraphVolume::Graph&     graph     = todo[i]->mutableGraph();
+			GraphVolume::Positions& positions = todo[i]->mutablePositions();
+
+			// the slab objects of this label, or null
+			std::vector<const SlabObject*> objects(numSlabs, 0);
+			for (std::size_t s = 0; s < numSlabs; s++) {
+
+				auto object = slabObjects[s].find(label);
+				if (object != slabObjects[s].end())
+					objects[s] = &object->second;
+			}
+
+			graph.reserveNode(numNodes[i]);
+			graph.reserveEdge(numEdges[i]);
+
+			// node ids are consecutive in a new ListGraph
+			for (std::size_t s = 0; s < numSlabs; s++)
+				if (objects[s])
+					for (const Position& position : objects[s]->nodes)
+						positions[graph.addNode()] = position;
+
+			for (std::size_t s = 0; s < numSlabs; s++) {
+
+				if (!objects[s])
+					continue;
+
+				// The nodes of a slab object are in scan order, and so are 
+				// their neighbors in each direction. One cursor per direction 
+				// into this and the previous slab object finds the neighbors 
+				// without an index from positions to nodes.
+				std::vector<std::size_t> cursors(neighbors.size(), 0);
+				std::vector<std::size_t> previousCursors(neighbors.size(), 0);
+
+				for (std::size_t n = 0; n < objects[s]->nodes.size(); n++) {
+
+					const Position& position = objects[s]->nodes[n];
+					GraphVolume::Node node = graph.nodeFromId(objects[s]->firstNode + n);
+
+					for (std::size_t k = 0; k < neighbors.size(); k++) {
+
+						int nx = position.x() + neighbors[k].x();
+						int ny = position.y() + neighbors[k].y();
+						int nz = position.z() + neighbors[k].z();
+
+						if (nx < 0 || nx >= width || ny < 0 || ny >= height || nz < 0 || labels(nx, ny, nz) != label)
+							continue;
+
+						// preceding neighbors are in this or the previous slab
+						const bool        previous       = (nz < slabBegin(s));
+						const SlabObject* neighborObject = (previous ? objects[s - 1] : objects[s]);
+						std::size_t&      cursor         = (previous ? previousCursors[k] : cursors[k]);
+
+						while (before(neighborObject->nodes[cursor], nx, ny, nz))
+							cursor++;
+
+						graph.addEdge(graph.nodeFromId(neighborObject->firstNode + cursor), node);
+					}
+				}
+			}
+		}
+	});
+
+	return graphVolumes;
+}
+
+#endif // IMAGEPROCESSING_EXTRACT_GRAPH_VOLUMES_H__
+
@@ -0,0 +1,133 @@
+#ifndef IMAGEPROCESSING_EXTRACT_OBJECTS_H__
+#define IMAGEPROCESSING_EXTRACT_OBJECTS_H__
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <util/box.hpp>
+#include "ExplicitVolume.h"
+#include "parallel.h"
+
+/**
+ * Split a label volume into one binary mask per label, in a single pass over 
+ * the volume. Each mask is cropped to the bounding box of its label, and 
+ * positioned such that its voxels are at the same locations as the 
+ * corresponding voxels in the label volume. To create a GraphVolume for each 
+ * label, use extractGraphVolumes() instead.
+ *
+ * The label volume is scanned in parallel slabs, collecting the voxels of each 
+ * label. This scan is linear in the size of the volume. Creating the masks, 
+ * however, allocates and clears a dense volume per label, such that the total 
+ * cost (and memory) is linear in the size of the volume plus the sum of the 
+ * bounding box sizes of all labels. For large or interleaved objects, the 
+ * latter can be much larger than the volume itself. If only the voxels of 
+ * each label are needed, use extractGraphVolumes(), which does not create 
+ * masks.
+ *
+ * @param labels
+ *              The label volume. Voxels with label 0 are considered 
+ *              background.
+ *
+ * @return A mask for each label, with inside voxels set to 1.
+ */
+template <typename T>
+std::map<T, ExplicitVolume<unsigned char> >
+extractObjects(const ExplicitVolume<T>& labels) {
+
+	typedef util::point<unsigned int,3> Position;
+
+	struct Object {
+
+		std::vector<Position>     voxels;
+		util::box<unsigned int,3> boundingBox;
+	};
+
+	typedef std::unordered_map<T, Object> Objects;
+
+	const unsigned int depth = labels.depth();
+	const std::size_t numSlabs = std::max<std::size_t>(std::min<std::size_t>(numParallelThreads(), depth), 1);
+	std::vector<Objects> slabObjects(numSlabs);
+
+	// collect the voxels of each label per slab
+	parallelFor(0, numSlabs, [&](std::size_t beginSlab, std::size_t endSlab) {
+
+		for (std::size_t s = beginSlab; s < endSlab; s++) {
+
+			Objects& objects = slabObjects[s];
+
+			for (unsigned int z = s*depth/numSlabs; z < (s + 1)*depth/numSlabs; z++)
+			for (unsigned int y = 0; y < labels.height(); y++) {
+
+				// consecutive voxels mostly have the same label, avoid hash 
+				// lookups for them
+				T       previous = 0;
+				Object* object   = 0;
+
+				for (unsigned int x = 0; x < labels.width(); x++) {
+
+					T label = labels(x, y, z);
+					if (label == 0)
+						continue;
+
+					if (label != previous || object == 0) {
+
+						object   = &objects[label];
+						previous = label;
+					}
+
+					object->voxels.push_back(Position(x, y, z));
+					object->boundingBox.fit(util::box<unsigned int,3>(x, y, z, x + 1, y + 1, z + 1));
+				}
+			}
+		}
+	},
+	1);
+
+	// create the masks
+	std::map<T, ExplicitVolume<unsigned char> > masks;
+	std::map<T, util::box<unsigned int,3> >     boundingBoxes;
+	for (const Objects& objects : slabObjects)
+		for (const auto& p : objects)
+			boundingBoxes[p.first].fit(p.second.boundingBox);
+
+	std::vector<T> ids;
+	std::vector<std::pair<const util::box<unsigned int,3>*, ExplicitVolume<unsigned char>*> > todo;
+	for (const auto& p : boundingBoxes) {
+
+		const util::box<unsigned int,3>& bb = p.second;
+
+		ExplicitVolume<unsigned char>& mask = masks[p.first];
+		mask.resize(bb.width(), bb.height(), bb.depth());
+		mask.setResolution(labels.getResolution());
+		mask.setOffset(labels.getOffset() + bb.min()*labels.getResolution());
+
+		ids.push_back(p.first);
+		todo.push_back(std::make_pair(&bb, &mask));
+	}
+
+	// fill the masks
+
+	parallelFor(0, ids.size(), [&](std::size_t begin, std::size_t end) {
+
+		for (std::size_t i = begin; i < end; i++) {
+
+			const Position& min = todo[i].first->min();
+			ExplicitVolume<unsigned char>& mask = *todo[i].second;
+
+			for (const Objects& objects : slabObjects) {
+
+				auto object = objects.find(ids[i]);
+				if (object == objects.end())
+					continue;
+
+				for (const Position& p : object->second.voxels)
+					mask(p.x() - min.x(), p.y() - min.y(), p.z() - min.z()) = 1;
+			}
+		}
+	});
+
+	return masks;
+}
+
+#endif // IMAGEPROCESSING_EXTRACT_OBJECTS_H__
+
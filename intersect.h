@@ -1,16 +1,173 @@
 #ifndef IMAGEPROCESSING_INTERSECT_H__
 #define IMAGEPROCESSING_INTERSECT_H__
 
+#include <algorithm>
 #include "ExplicitVolume.h"
+#include "parallel.h"
 #include <util/assert.h>
 
 /**
- * Stores the result of intersecting two volumes A and B in C. The intersection 
- * is the smallest box containing voxels that are non-zero in both A and B. The 
- * values of voxels in C are the minimal values of the corresponding voxels in A 
+ * Statistics of the intersection of two volumes A and B, in discrete
+ * coordinates of A.
+ */
+struct IntersectionStatistics {
+
+	/**
+	 * The number of voxels that are non-zero in both A and B.
+	 */
+	std::size_t size = 0;
+
+	/**
+	 * The smallest box containing voxels that are non-zero in both A and B.
+	 */
+	util::box<int,3> boundingBox;
+};
+
+/**
+ * Find the region of A that overlaps with B, in discrete coordinates of A.
+ * Sets offsetAB to the discrete offset from A to B. Returns false, if the
+ * volumes do not overlap.
+ */
+template <typename VolumeA, typename VolumeB>
+bool
+intersectionRegion(
+		const VolumeA& a,
+		const VolumeB& b,
+		util::point<int,3>& offsetAB,
+		util::box<int,3>& region) {
+
+	UTIL_ASSERT_REL(a.getResolution(), ==, b.getResolution());
+
+	offsetAB = (a.getOffset() - b.getOffset())/a.getResolution();
+
+	region = util::box<int,3>(
+			std::max(0, -offsetAB.x()),
+			std::max(0, -offsetAB.y()),
+			std::max(0, -offsetAB.z()),
+			std::min(static_cast<int>(a.width()),  static_cast<int>(b.width())  - offsetAB.x()),
+			std::min(static_cast<int>(a.height()), static_cast<int>(b.height()) - offsetAB.y()),
+			std::min(static_cast<int>(a.depth()),  static_cast<int>(b.depth())  - offsetAB.z()));
+
+	return
+			region.min().x() < region.max().x() &&
+			region.min().y() < region.max().y() &&
+			region.min().z() < region.max().z();
+}
+
+/**
+ * Visit the rows of the overlap of A and B in parallel slabs along z. Calls
+ * f(slab, rowA, rowB, strideA, strideB, y, z) for each row, where rowA and rowB
+ * point to the first voxel of the row in the region. If A is not const, rowA
+ * can be written to. Slabs are not created for less than 2^16 voxels, such
+ * that small volumes are processed without overhead.
+ */
+template <typename VolumeA, typename VolumeB, typename F>
+void
+forEachIntersectionRow(
+		VolumeA& a,
+		const VolumeB& b,
+		const util::point<int,3>& offsetAB,
+		const util::box<int,3>& region,
+		F f) {
+
+	const std::ptrdiff_t strideA = a.data().stride(0);
+	const std::ptrdiff_t strideB = b.data().stride(0);
+
+	const std::size_t sliceSize = static_cast<std::size_t>(region.width())*region.height();
+	const std::size_t minSlabSize = std::max<std::size_t>((1 << 16)/sliceSize, 1);
+
+	parallelFor(region.min().z(), region.max().z(), [&](std::size_t beginZ, std::size_t endZ) {
+
+		for (int z = beginZ; z < static_cast<int>(endZ); z++)
+		for (int y = region.min().y(); y < region.max().y(); y++)
+			f(
+					beginZ,
+					&a(region.min().x(), y, z),
+					&b(region.min().x() + offsetAB.x(), y + offsetAB.y(), z + offsetAB.z()),
+					strideA,
+					strideB,
+					y,
+					z);
+	},
+	minSlabSize);
+}
+
+/**
+ * Compute the number of voxels and the bounding box of the intersection of two
+ * volumes A and B, without creating the intersection. See intersect().
+ */
+template <typename VolumeA, typename VolumeB>
+IntersectionStatistics
+intersectionStatistics(
+		const VolumeA& a,
+		const VolumeB& b) {
+
+	IntersectionStatistics statistics;
+
+	util::point<int,3> offsetAB;
+	util::box<int,3>   region;
+
+	if (!intersectionRegion(a, b, offsetAB, region))
+		return statistics;
+
+	// statistics per slab, indexed by the first slice of the slab
+	std::vector<IntersectionStatistics> slabStatistics(region.depth());
+
+	forEachIntersectionRow(a, b, offsetAB, region, [&](
+			std::size_t slab,
+			const typename VolumeA::value_type* rowA,
+			const typename VolumeB::value_type* rowB,
+			std::ptrdiff_t strideA,
+			std::ptrdiff_t strideB,
+			int y,
+			int z) {
+
+		// the first and last intersecting voxel of the row
+		int         first = region.width();
+		int         last  = -1;
+		std::size_t size  = 0;
+
+		for (int x = 0; x < region.width(); x++) {
+
+			bool inside = (rowA[x*strideA] != 0 && rowB[x*strideB] > 0);
+
+			size  += inside;
+			first  = (inside && x < first ? x : first);
+			last   = (inside ? x : last);
+		}
+
+		if (size == 0)
+			return;
+
+		IntersectionStatistics& s = slabStatistics[slab - region.min().z()];
+		s.size += size;
+		s.boundingBox.fit(
+				util::box<int,3>(
+						region.min().x() + first, y, z,
+						region.min().x() + last + 1, y + 1, z + 1));
+	});
+
+	for (const IntersectionStatistics& s : slabStatistics) {
+
+		if (s.size == 0)
+			continue;
+
+		statistics.size += s.size;
+		statistics.boundingBox.fit(s.boundingBox);
+	}
+
+	return statistics;
+}
+
+/**
+ * Stores the result of intersecting two volumes A and B in C. The intersection
+ * is the smallest box containing voxels that are non-zero in both A and B. The
+ * values of voxels in C are the minimal values of the corresponding voxels in A
  * and B.
  *
- * A and B need to have the same resolution.
+ * A and B need to have the same resolution. They can be ExplicitVolumes or
+ * ExplicitVolumeViews. Only the overlap of A and B is scanned, in parallel
+ * slabs.
  *
  * @param[in] a
  *             The first volume.
@@ -19,70 +176,79 @@
  * @param[out] c
  *             The result of intersecting the given volumes.
  */
-template <typename T>
+template <typename VolumeA, typename VolumeB, typename T>
 void intersect(
-		const ExplicitVolume<T>& a,
-		const ExplicitVolume<T>& b,
+		const VolumeA& a,
+		const VolumeB& b,
 		ExplicitVolume<T>& c) {
 
-	UTIL_ASSERT_REL(a.getResolution(), ==, b.getResolution());
-
-	// discrete offset from a to b
-	util::point<int, 3> offsetAB = (a.getOffset() - b.getOffset())/a.getResolution();
-
-	// get discrete bounding box of c relative to discrete bounding box of a
-	util::box<int, 3> c_dbb;
-	for (int z = 0; z < a.depth();  z++)
-	for (int y = 0; y < a.height(); y++)
-	for (int x = 0; x < a.width();  x++) {
-
-		T valueA = a(x, y, z);
-
-		if (valueA == 0)
-			continue;
-
-		util::point<int, 3> bpos(
-				x + offsetAB.x(),
-				y + offsetAB.y(),
-				z + offsetAB.z());
-
-		if (b.getDiscreteBoundingBox().contains(bpos) && b[bpos] > 0)
-			c_dbb.fit(util::box<int, 3>(x, y, z, x+1, y+1, z+1));
-	}
+	IntersectionStatistics statistics = intersectionStatistics(a, b);
+	const util::box<int,3>& c_dbb = statistics.boundingBox;
 
 	c.resize(c_dbb.width(), c_dbb.height(), c_dbb.depth());
 	c.data() = 0;
 	c.setResolution(a.getResolution());
 	c.setOffset(a.getOffset() + c_dbb.min()*a.getResolution());
 
-	util::point<int, 3> offsetAC = -c_dbb.min();
-	util::point<int, 3> offsetBC = -offsetAB + offsetAC;
+	if (statistics.size == 0)
+		return;
+
+	util::point<int,3> offsetAB = (a.getOffset() - b.getOffset())/a.getResolution();
 
 	// fill non-zero values of c
-	for (int z = 0; z < c.depth();  z++)
-	for (int y = 0; y < c.height(); y++)
-	for (int x = 0; x < c.width();  x++) {
+	forEachIntersectionRow(a, b, offsetAB, c_dbb, [&](
+			std::size_t,
+			const typename VolumeA::value_type* rowA,
+			const typename VolumeB::value_type* rowB,
+			std::ptrdiff_t strideA,
+			std::ptrdiff_t strideB,
+			int y,
+			int z) {
+
+		T* rowC = &c(0, y - c_dbb.min().y(), z - c_dbb.min().z());
+
+		for (int x = 0; x < c_dbb.width(); x++) {
+
+			T valueA = rowA[x*strideA];
+			T valueB = rowB[x*strideB];
+
+			if (valueA != 0)
+				rowC[x] = std::min(valueA, valueB);
+		}
+	});
+}
 
-		util::point<int, 3> posA(
-				x - offsetAC.x(),
-				y - offsetAC.y(),
-				z - offsetAC.z());
+/**
+ * Test whether two volumes A and B have a voxel that is non-zero in both.
+ * Stops at the first such voxel.
+ */
+template <typename VolumeA, typename VolumeB>
+bool
+overlap(
+		const VolumeA& a,
+		const VolumeB& b) {
 
-		T valueA = a[posA];
+	util::point<int,3> offsetAB;
+	util::box<int,3>   region;
 
-		if (valueA == 0)
-			continue;
+	if (!intersectionRegion(a, b, offsetAB, region))
+		return false;
 
-		util::point<int, 3> posB(
-				x - offsetBC.x(),
-				y - offsetBC.y(),
-				z - offsetBC.z());
+	const std::ptrdiff_t strideA = a.data().stride(0);
+	const std::ptrdiff_t strideB = b.data().stride(0);
 
-		T valueB = b[posB];
+	for (int z = region.min().z(); z < region.max().z(); z++)
+	for (int y = region.min().y(); y < region.max().y(); y++) {
 
-		c(x, y, z) = std::min(valueA, valueB);
+		const typename VolumeA::value_type* rowA = &a(region.min().x(), y, z);
+		const typename VolumeB::value_type* rowB = &b(region.min().x() + offsetAB.x(), y + offsetAB.y(), z + offsetAB.z());
+
+		for (int x = 0; x < region.width(); x++)
+			if (rowA[x*strideA] != 0 && rowB[x*strideB] > 0)
+				return true;
 	}
+
+	return false;
 }
 
 #endif // IMAGEPROCESSING_INTERSECT_H__
-
@@ -0,0 +1,96 @@
+#ifndef IMAGEPROCESSING_PARALLEL_H__
+#define IMAGEPROCESSING_PARALLEL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+inline std::atomic<std::size_t>& parallelThreadsSetting() {
+
+	// 0 means one thread per hardware thread
+	static std::atomic<std::size_t> numThreads(0);
+	return numThreads;
+}
+
+/**
+ * Set the number of threads to use for parallel operations on volumes. Set to 
+ * 0 to use one thread per hardware thread (the default).
+ */
+inline void setNumParallelThreads(std::size_t numThreads) {
+
+	parallelThreadsSetting() = numThreads;
+}
+
+/**
+ * The number of threads to use for parallel operations on volumes.
+ */
+inline std::size_t numParallelThreads() {
+
+	std::size_t numThreads = parallelThreadsSetting();
+
+	if (numThreads > 0)
+		return numThreads;
+
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/**
+ * Split the range [begin, end) into consecutive blocks of roughly equal size, 
+ * one per thread, and call f(blockBegin, blockEnd) for each of them in 
+ * parallel. Blocks are not smaller than minBlockSize, such that small ranges 
+ * are processed by fewer threads. Returns after all blocks have been 
+ * processed. Exceptions thrown by f are passed on to the caller.
+ */
+template <typename F>
+void parallelFor(std::size_t begin, std::size_t end, F f, std::size_t minBlockSize = 1) {
+
+	if (begin >= end)
+		return;
+
+	std::size_t size       = end - begin;
+	std::size_t numBlocks  = std::min(numParallelThreads(), std::max(size/std::max(minBlockSize, (std::size_t)1), (std::size_t)1));
+	std::size_t blockSize  = (size + numBlocks - 1)/numBlocks;
+
+	if (numBlocks == 1) {
+
+		f(begin, end);
+		return;
+	}
+
+	std::vector<std::exception_ptr> exceptions(numBlocks);
+	std::vector<std::thread>        threads;
+
+	for (std::size_t i = 0; i < numBlocks; i++) {
+
+		std::size_t blockBegin = begin + i*blockSize;
+		std::size_t blockEnd   = std::min(blockBegin + blockSize, end);
+
+		if (blockBegin >= blockEnd)
+			break;
+
+		threads.emplace_back([&f, &exceptions, i, blockBegin, blockEnd]() {
+
+			try {
+
+				f(blockBegin, blockEnd);
+
+			} catch (...) {
+
+				exceptions[i] = std::current_exception();
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (std::exception_ptr& exception : exceptions)
+		if (exception)
+			std::rethrow_exception(exception);
+}
+
+#endif // IMAGEPROCESSING_PARALLEL_H__
+
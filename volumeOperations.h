@@ -0,0 +1,300 @@
+#ifndef IMAGEPROCESSING_VOLUME_OPERATIONS_H__
+#define IMAGEPROCESSING_VOLUME_OPERATIONS_H__
+
+#include <algorithm>
+#include "ExplicitVolume.h"
+#include "RunLengthVolume.h"
+#include "intersect.h"
+#include "parallel.h"
+
+/**
+ * Which region of two volumes A and B the result of combine() covers.
+ */
+enum CombinationExtent {
+
+	/**
+	 * The overlap of A and B.
+	 */
+	IntersectionExtent,
+
+	/**
+	 * The smallest box containing A and B.
+	 */
+	UnionExtent,
+
+	/**
+	 * The region of A.
+	 */
+	FirstExtent
+};
+
+/**
+ * Combine two volumes A and B voxel by voxel and store the result in C. C is
+ * set to the given extent, and for each of its voxels set to op(a, b), where a
+ * and b are the values of A and B at the same location, or 0 outside of them.
+ * op(0, 0) has to be 0.
+ *
+ * A and B need to have the same resolution, their offsets can differ. They
+ * can be ExplicitVolumes, ExplicitVolumeViews, or MemoryMappedVolumes. Rows of
+ * C are split into segments covered by A, B, or both, which are processed
+ * with plain loops over raw memory. Slabs along z are processed in parallel.
+ */
+template <typename VolumeA, typename VolumeB, typename T, typename Op>
+void combine(
+		const VolumeA& a,
+		const VolumeB& b,
+		ExplicitVolume<T>& c,
+		CombinationExtent extent,
+		Op op) {
+
+	util::point<int,3> offsetAB;
+	util::box<int,3>   overlap;
+	bool overlapping = intersectionRegion(a, b, offsetAB, overlap);
+
+	// boxes of A and B in discrete coordinates of A
+	util::box<int,3> boxA(0, 0, 0, a.width(), a.height(), a.depth());
+	util::box<int,3> boxB(
+			-offsetAB.x(), -offsetAB.y(), -offsetAB.z(),
+			static_cast<int>(b.width())  - offsetAB.x(),
+			static_cast<int>(b.height()) - offsetAB.y(),
+			static_cast<int>(b.depth())  - offsetAB.z());
+
+	util::box<int,3> region;
+	switch (extent) {
+
+		case IntersectionExtent:
+			region = (overlapping ? overlap : util::box<int,3>(0, 0, 0, 0, 0, 0));
+			break;
+
+		case UnionExtent:
+			region = util::box<int,3>(
+					std::min(boxA.min().x(), boxB.min().x()),
+					std::min(boxA.min().y(), boxB.min().y()),
+					std::min(boxA.min().z(), boxB.min().z()),
+					std::max(boxA.max().x(), boxB.max().x()),
+					std::max(boxA.max().y(), boxB.max().y()),
+					std::max(boxA.max().z(), boxB.max().z()));
+			break;
+
+		case FirstExtent:
+			region = boxA;
+			break;
+	}
+
+	c.resize(region.width(), region.height(), region.depth());
+	c.data() = 0;
+	c.setResolution(a.getResolution());
+	c.setOffset(a.getOffset() + region.min()*a.getResolution());
+
+	if (region.width() == 0 || region.height() == 0 || region.depth() == 0)
+		return;
+
+	const std::ptrdiff_t strideA = a.data().stride(0);
+	const std::ptrdiff_t strideB = b.data().stride(0);
+
+	// process a segment of the given size, starting at the given voxels of
+	// C, A, and B, pointers are null for volumes not covering the segment
+	auto combineSegment = [&](
+			T* segmentC,
+			const typename VolumeA::value_type* segmentA,
+			const typename VolumeB::value_type* segmentB,
+			int size) {
+
+		if (segmentA && segmentB)
+			for (int x = 0; x < size; x++)
+				segmentC[x] = op(static_cast<T>(segmentA[x*strideA]), static_cast<T>(segmentB[x*strideB]));
+		else if (segmentA)
+			for (int x = 0; x < size; x++)
+				segmentC[x] = op(static_cast<T>(segmentA[x*strideA]), static_cast<T>(0));
+		else if (segmentB)
+			for (int x = 0; x < size; x++)
+				segmentC[x] = op(static_cast<T>(0), static_cast<T>(segmentB[x*strideB]));
+	};
+
+	const std::size_t sliceSize   = static_cast<std::size_t>(region.width())*region.height();
+	const std::size_t minSlabSize = std::max<std::size_t>((1 << 16)/sliceSize, 1);
+
+	parallelFor(0, region.depth(), [&](std::size_t beginZ, std::size_t endZ) {
+
+		for (int cz = beginZ; cz < static_cast<int>(endZ); cz++)
+		for (int cy = 0; cy < region.height(); cy++) {
+
+			int y = cy + region.min().y();
+			int z = cz + region.min().z();
+
+			bool inA = (y >= boxA.min().y() && y < boxA.max().y() && z >= boxA.min().z() && z < boxA.max().z());
+			bool inB = (y >= boxB.min().y() && y < boxB.max().y() && z >= boxB.min().z() && z < boxB.max().z());
+
+			// ranges of A and B in the row, in coordinates of C
+			int beginA = (inA ? std::max(boxA.min().x(), region.min().x()) - region.min().x() : 0);
+			int endA   = (inA ? std::min(boxA.max().x(), region.max().x()) - region.min().x() : 0);
+			int beginB = (inB ? std::max(boxB.min().x(), region.min().x()) - region.min().x() : 0);
+			int endB   = (inB ? std::min(boxB.max().x(), region.max().x()) - region.min().x() : 0);
+
+			T* rowC = &c(0, cy, cz);
+
+			// split the row at the range boundaries
+			int bounds[6] = { 0, beginA, endA, beginB, endB, region.width() };
+			std::sort(bounds, bounds + 6);
+
+			for (int i = 0; i < 5; i++) {
+
+				int begin = bounds[i];
+				int end   = bounds[i + 1];
+
+				if (begin >= end)
+					continue;
+
+				bool coveredA = (begin >= beginA && end <= endA);
+				bool coveredB = (begin >= beginB && end <= endB);
+
+				int x = begin + region.min().x();
+
+				combineSegment(
+						rowC + begin,
+						(coveredA ? &a(x, y, z) : 0),
+						(coveredB ? &b(x + offsetAB.x(), y + offsetAB.y(), z + offsetAB.z()) : 0),
+						end - begin);
+			}
+		}
+	},
+	minSlabSize);
+}
+
+/**
+ * Combine a volume B into a volume A in-place, by setting each voxel of A that
+ * is covered by B to op(a, b).
+ */
+template <typename T, typename VolumeB, typename Op>
+void combineInPlace(
+		ExplicitVolume<T>& a,
+		const VolumeB& b,
+		Op op) {
+
+	util::point<int,3> offsetAB;
+	util::box<int,3>   region;
+
+	if (!intersectionRegion(a, b, offsetAB, region))
+		return;
+
+	forEachIntersectionRow(a, b, offsetAB, region, [&](
+			std::size_t,
+			T* rowA,
+			const typename VolumeB::value_type* rowB,
+			std::ptrdiff_t strideA,
+			std::ptrdiff_t strideB,
+			int,
+			int) {
+
+		for (int x = 0; x < region.width(); x++)
+			rowA[x*strideA] = op(rowA[x*strideA], static_cast<T>(rowB[x*strideB]));
+	});
+}
+
+/**
+ * The union of A and B: the maximum of both volumes, over the smallest box
+ * containing them.
+ */
+template <typename VolumeA, typename VolumeB, typename T>
+void unite(const VolumeA& a, const VolumeB& b, ExplicitVolume<T>& c) {
+
+	combine(a, b, c, UnionExtent, [](T a, T b) { return std::max(a, b); });
+}
+
+/**
+ * The difference of A and B: the voxels of A that are zero in B, over the
+ * region of A.
+ */
+template <typename VolumeA, typename VolumeB, typename T>
+void difference(const VolumeA& a, const VolumeB& b, ExplicitVolume<T>& c) {
+
+	combine(a, b, c, FirstExtent, [](T a, T b) { return (b == 0 ? a : static_cast<T>(0)); });
+}
+
+/**
+ * The symmetric difference of A and B: the voxels that are non-zero in
+ * exactly one of them, over the smallest box containing them.
+ */
+template <typename VolumeA, typename VolumeB, typename T>
+void symmetricDifference(const VolumeA& a, const VolumeB& b, ExplicitVolume<T>& c) {
+
+	combine(a, b, c, UnionExtent, [](T a, T b) { return (b == 0 ? a : (a == 0 ? b : static_cast<T>(0))); });
+}
+
+/**
+ * The voxel-wise sum of A and B, over the smallest box containing them.
+ */
+template <typename VolumeA, typename VolumeB, typename T>
+void add(const VolumeA& a, const VolumeB& b, ExplicitVolume<T>& c) {
+
+	combine(a, b, c, UnionExtent, [](T a, T b) { return static_cast<T>(a + b); });
+}
+
+/**
+ * The voxel-wise difference of A and B, over the smallest box containing them.
+ */
+template <typename VolumeA, typename VolumeB, typename T>
+void subtract(const VolumeA& a, const VolumeB& b, ExplicitVolume<T>& c) {
+
+	combine(a, b, c, UnionExtent, [](T a, T b) { return static_cast<T>(a - b); });
+}
+
+/**
+ * The voxel-wise product of A and B, over their overlap.
+ */
+template <typename VolumeA, typename VolumeB, typename T>
+void multiply(const VolumeA& a, const VolumeB& b, ExplicitVolume<T>& c) {
+
+	combine(a, b, c, IntersectionExtent, [](T a, T b) { return static_cast<T>(a*b); });
+}
+
+/**
+ * Set all voxels of a target volume to the given value, where a mask is
+ * non-zero. The mask can have a different offset.
+ */
+template <typename T, typename MaskType>
+void assignMasked(ExplicitVolume<T>& target, const MaskType& mask, typename ExplicitVolume<T>::value_type value) {
+
+	combineInPlace(target, mask, [value](T t, T m) { return (m != 0 ? value : t); });
+}
+
+/**
+ * Set all voxels of a target volume to the given value, where a run-length
+ * encoded mask is inside. Only the runs of the mask are visited.
+ */
+template <typename T>
+void assignMasked(ExplicitVolume<T>& target, const RunLengthVolume& mask, typename ExplicitVolume<T>::value_type value) {
+
+	UTIL_ASSERT_REL(target.getResolution(), ==, mask.getResolution());
+
+	// discrete offset from the mask to the target
+	util::point<int,3> offset = (mask.getOffset() - target.getOffset())/target.getResolution();
+
+	const int width  = target.width();
+	const int height = target.height();
+	const int depth  = target.depth();
+
+	parallelFor(0, mask.depth(), [&](std::size_t beginZ, std::size_t endZ) {
+
+		for (unsigned int z = beginZ; z < endZ; z++)
+		for (unsigned int y = 0; y < mask.height(); y++) {
+
+			int ty = y + offset.y();
+			int tz = z + offset.z();
+
+			if (ty < 0 || ty >= height || tz < 0 || tz >= depth)
+				continue;
+
+			for (RunLengthVolume::const_iterator run = mask.begin(y, z); run != mask.end(y, z); run++) {
+
+				int begin = std::max(static_cast<int>(run->begin) + offset.x(), 0);
+				int end   = std::min(static_cast<int>(run->end)   + offset.x(), width);
+
+				for (int x = begin; x < end; x++)
+					target(x, ty, tz) = value;
+			}
+		}
+	});
+}
+
+#endif // IMAGEPROCESSING_VOLUME_OPERATIONS_H__